@@ -1,15 +1,40 @@
 #include "devices/disk.h"
 #include <ctype.h>
+#include <limits.h>
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include "devices/pci.h"
 #include "devices/timer.h"
+#include "threads/init.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Data moves by PIO through the data register unless the
+   controller is a PCI bus-master IDE controller and the disk
+   supports DMA.  In that case the controller copies the data to
+   or from memory itself, following a table of physical region
+   descriptors, and interrupts once at the end.
+
+   Callers do not touch the hardware.  They queue requests on the
+   disk's channel with disk_submit() and wait for them with
+   disk_wait(), so that a caller with many sectors to move can
+   have them all queued at once.  A dispatcher thread per channel
+   owns the controller: it asks the channel's scheduler for the
+   next request, merges in queued requests for the sectors that
+   follow it, carries out the lot as one command, and on the
+   completion interrupt moves on to the next.
+
+   Every request is tagged with what it is for (see
+   disk_set_tag()), and completed requests are recorded in a ring
+   buffer, along with their latency, for tracing. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -32,6 +57,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -41,12 +67,50 @@
 #define DEV_LBA 0x40            /* Linear based addressing. */
 #define DEV_DEV 0x10            /* Select device: 0=master, 1=slave. */
 
+/* Bus-master IDE registers, relative to a channel's bm_base. */
+#define BM_COMMAND 0            /* Command. */
+#define BM_STATUS 2             /* Status. */
+#define BM_PRDT 4               /* Physical address of PRD table. */
+
+/* Bus-master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus-master Status Register bits.  Writing 1 clears them. */
+#define BM_STA_ERR 0x02         /* Error. */
+#define BM_STA_INTR 0x04        /* Interrupt. */
+
 /* Commands.
    Many more are defined but this is the small subset that we
    use. */
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* A physical region descriptor: one physically contiguous piece
+   of a DMA transfer's memory, which may not cross a 64 kB
+   boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Byte count; 0 means 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last entry. */
+  };
+
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Most requests merged into a single command. */
+#define MERGE_MAX 16
+
+/* PRD table entries per channel.  Each of up to MERGE_MAX merged
+   requests moves at most 128 kB, which crosses at most two 64 kB
+   boundaries. */
+#define PRD_CNT (3 * MERGE_MAX)
 
 /* An ATA device. */
 struct disk 
@@ -57,9 +121,21 @@ struct disk
 
     bool is_ata;                /* 1=This device is an ATA disk. */
     disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+    int multiple;               /* Sectors per interrupt with READ/WRITE
+                                   MULTIPLE, or 0 if not supported. */
+    bool dma;                   /* Transfer by bus-master DMA? */
+
+    disk_sector_t head;         /* Sector after the last one moved. */
 
     long long read_cnt;         /* Number of sectors read. */
     long long write_cnt;        /* Number of sectors written. */
+    long long intr_cnt;         /* Number of interrupts waited for. */
+    int64_t busy_ticks;         /* Ticks spent transferring data. */
+    long long request_cnt;      /* Requests submitted. */
+    long long command_cnt;      /* Commands issued for them. */
+    long long seek_sectors;     /* Total distance from head to request. */
+    long long depth_sum;        /* Sum of queue depths seen on submit. */
+    int depth_max;              /* Deepest queue seen on submit. */
   };
 
 /* An ATA channel (aka controller).
@@ -70,11 +146,25 @@ struct channel
     uint16_t reg_base;          /* Base I/O port. */
     uint8_t irq;                /* Interrupt in use. */
 
-    struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    struct lock lock;           /* Protects the queue. */
+    struct list queue;          /* Requests waiting to be dispatched. */
+    struct condition queue_nonempty;    /* Signaled on submit. */
+    int queue_len;              /* Requests in QUEUE. */
+    int active_cnt;             /* Requests being carried out. */
+
+    bool busy;                  /* Requests queued or in progress? */
+    int64_t busy_start;         /* When BUSY last became true. */
+    int64_t busy_ticks;         /* Ticks busy, not counting the current
+                                   stretch. */
+
+    uint16_t bm_base;           /* Bus-master registers, or 0 if none. */
+    struct prd prdt[PRD_CNT] __attribute__ ((aligned (512)));
+                                /* PRD table for bus-master DMA. */
+
     struct disk devices[2];     /* The devices on this channel. */
   };
 
@@ -82,26 +172,99 @@ struct channel
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Channel utilization.  Updated with interrupts off. */
+static int busy_channels;           /* Channels now busy. */
+static int64_t busy_change;         /* When BUSY_CHANNELS last changed. */
+static int64_t overlap_ticks;       /* Ticks all channels were busy, not
+                                       counting the current stretch. */
+
+/* Use bus-master DMA where the controller supports it? */
+bool disk_use_dma = true;
+
+/* Print the disk I/O trace at shutdown? */
+bool disk_trace_dump;
+
+/* Simulated crash; see disk_crash_after().  Updated with
+   interrupts off. */
+static struct disk *crash_disk;     /* Disk to count writes to. */
+static long long crash_budget;      /* Sectors it may still take. */
+static struct thread *crash_thread; /* Thread crashing, once one is. */
+static struct semaphore crash_sema; /* Never up'd. */
+
+/* I/O trace: the last TRACE_CNT requests completed, in a ring.
+   Updated with interrupts off. */
+#define TRACE_CNT 1024
+static struct disktrace trace[TRACE_CNT];
+static long long trace_cnt;         /* Requests recorded, ever. */
+static long long tag_cnt[DISK_TAG_CNT];   /* Requests, by tag. */
+static long long latency_hist[2][DISK_HIST_CNT];  /* See diskstat. */
+
+/* Names of tags, for printing. */
+static const char *tag_names[DISK_TAG_CNT] =
+  {"other", "data", "dir", "inode", "free-map", "writeback", "evict", "swap",
+   "journal"};
+
+/* A request scheduler: chooses which of the requests queued on a
+   channel to carry out next. */
+struct scheduler
+  {
+    const char *name;
+    struct disk_request *(*pick) (struct channel *);
+  };
+
+static struct disk_request *pick_fifo (struct channel *);
+static struct disk_request *pick_clook (struct channel *);
+static struct disk_request *pick_deadline (struct channel *);
+
+static const struct scheduler schedulers[] =
+  {
+    {"fifo", pick_fifo},
+    {"clook", pick_clook},
+    {"deadline", pick_deadline},
+  };
+#define SCHEDULER_CNT (sizeof schedulers / sizeof *schedulers)
+
+/* Scheduler in use; set with the -ds kernel command line option. */
+static const struct scheduler *scheduler = &schedulers[2];
+
+/* Deadline scheduler: ticks a read or write may wait before it
+   goes ahead of everything else. */
+#define READ_DEADLINE (TIMER_FREQ / 20)
+#define WRITE_DEADLINE (TIMER_FREQ / 2)
+
+static uint16_t find_bus_master (void);
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
+static void set_multiple_mode (struct disk *, int sectors);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void select_sectors (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void wait_for_completion (struct disk *);
+static void input_sectors (struct channel *, void *, size_t cnt);
+static void output_sectors (struct channel *, const void *, size_t cnt);
 
 static void wait_until_idle (const struct disk *);
 static bool wait_while_busy (const struct disk *);
 static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
+static bool pio_transfer (struct disk *, struct disk_request *[],
+                          size_t req_cnt, size_t sectors);
+static bool dma_transfer (struct disk *, struct disk_request *[],
+                          size_t req_cnt, size_t sectors);
+static thread_func dispatcher NO_RETURN;
+static void channel_set_busy (struct channel *, bool busy);
+static void crash_account (struct disk_request *);
+
 static void interrupt_handler (struct intr_frame *);
 
 /* Initialize the disk subsystem and detect disks. */
 void
 disk_init (void) 
 {
+  uint16_t bm_base = disk_use_dma ? find_bus_master () : 0;
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -124,9 +287,15 @@ disk_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      lock_init_named (&c->lock, c->name);
+      list_init (&c->queue);
+      cond_init (&c->queue_nonempty);
+      c->queue_len = c->active_cnt = 0;
+      c->busy = false;
+      c->busy_start = c->busy_ticks = 0;
+      c->bm_base = bm_base != 0 ? bm_base + 8 * chan_no : 0;
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -138,8 +307,17 @@ disk_init (void)
 
           d->is_ata = false;
           d->capacity = 0;
+          d->multiple = 0;
+          d->dma = false;
+          d->head = 0;
 
           d->read_cnt = d->write_cnt = 0;
+          d->intr_cnt = 0;
+          d->busy_ticks = 0;
+          d->request_cnt = d->command_cnt = 0;
+          d->seek_sectors = 0;
+          d->depth_sum = 0;
+          d->depth_max = 0;
         }
 
       /* Register interrupt handler. */
@@ -156,27 +334,165 @@ disk_init (void)
       for (dev_no = 0; dev_no < 2; dev_no++)
         if (c->devices[dev_no].is_ata)
           identify_ata_device (&c->devices[dev_no]);
+
+      /* From here on, only the dispatcher touches the hardware. */
+      if (c->devices[0].is_ata || c->devices[1].is_ata)
+        {
+          char name[16];
+          snprintf (name, sizeof name, "%s-io", c->name);
+          thread_create (name, PRI_MAX, dispatcher, c);
+        }
     }
 }
 
-/* Prints disk statistics. */
+/* Prints N / D to two decimal places, or "-" if D is 0. */
+static void
+print_ratio (long long n, long long d)
+{
+  if (d == 0)
+    printf ("-");
+  else
+    {
+      long long hundredths = n * 100 / d;
+      printf ("%lld.%02lld", hundredths / 100, hundredths % 100);
+    }
+}
+
+/* Prints disk statistics: sectors moved, interrupts per sector,
+   and throughput while busy, then requests and the commands they
+   were merged into, seek distance and queue depth.  Finally,
+   prints how much of the time each channel was busy, and all of
+   them at once. */
 void
 disk_print_stats (void) 
 {
+  struct diskstat ds;
   int chan_no;
 
+  disk_get_stats (&ds);
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) 
     {
+      struct channel *c = &channels[chan_no];
       int dev_no;
 
+      if (c->devices[0].is_ata || c->devices[1].is_ata)
+        {
+          printf ("%s: busy %lld of %lld ticks (",
+                  c->name, ds.busy_ticks[chan_no], ds.uptime);
+          print_ratio (ds.busy_ticks[chan_no] * 100, ds.uptime);
+          printf ("%%)\n");
+        }
+
       for (dev_no = 0; dev_no < 2; dev_no++) 
         {
           struct disk *d = disk_get (chan_no, dev_no);
           if (d != NULL && d->is_ata) 
-            printf ("%s: %lld reads, %lld writes\n",
-                    d->name, d->read_cnt, d->write_cnt);
+            {
+              long long sectors = d->read_cnt + d->write_cnt;
+
+              printf ("%s: %lld reads, %lld writes, %lld interrupts (",
+                      d->name, d->read_cnt, d->write_cnt, d->intr_cnt);
+              print_ratio (d->intr_cnt, sectors);
+              printf (" per sector), %lld ticks busy (",
+                      (long long) d->busy_ticks);
+              print_ratio (sectors * DISK_SECTOR_SIZE * TIMER_FREQ,
+                           d->busy_ticks * 1024 * 1024);
+              printf (" MB/s)%s\n", d->dma ? ", DMA" : "");
+              printf ("%s: %lld requests in %lld commands, "
+                      "%lld sectors seeked, queue depth ",
+                      d->name, d->request_cnt, d->command_cnt,
+                      d->seek_sectors);
+              print_ratio (d->depth_sum, d->request_cnt);
+              printf (" avg, %d max (%s)\n", d->depth_max, scheduler->name);
+            }
         }
     }
+  printf ("Disk channels: all busy at once for %lld ticks\n",
+          ds.overlap_ticks);
+}
+
+/* Stores channel utilization statistics into *DS. */
+void
+disk_get_stats (struct diskstat *ds)
+{
+  enum intr_level old_level;
+  int64_t now;
+  int chan_no;
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  ds->uptime = now;
+  ds->overlap_ticks = overlap_ticks;
+  if (busy_channels == CHANNEL_CNT)
+    ds->overlap_ticks += now - busy_change;
+  for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+    {
+      struct channel *c = &channels[chan_no];
+      int dev_no;
+
+      ds->busy_ticks[chan_no] = c->busy_ticks;
+      if (c->busy)
+        ds->busy_ticks[chan_no] += now - c->busy_start;
+      ds->read_cnt[chan_no] = ds->write_cnt[chan_no] = 0;
+      for (dev_no = 0; dev_no < 2; dev_no++)
+        {
+          ds->read_cnt[chan_no] += c->devices[dev_no].read_cnt;
+          ds->write_cnt[chan_no] += c->devices[dev_no].write_cnt;
+        }
+    }
+  memcpy (ds->tag_cnt, tag_cnt, sizeof ds->tag_cnt);
+  memcpy (ds->hist, latency_hist, sizeof ds->hist);
+  intr_set_level (old_level);
+}
+
+/* Copies the last MAX or fewer requests in the I/O trace into
+   TRACE, oldest first, and returns the number copied. */
+int
+disk_get_trace (struct disktrace *out, int max)
+{
+  enum intr_level old_level;
+  long long first;
+  int cnt, i;
+
+  old_level = intr_disable ();
+  cnt = trace_cnt < TRACE_CNT ? trace_cnt : TRACE_CNT;
+  if (cnt > max)
+    cnt = max;
+  first = trace_cnt - cnt;
+  for (i = 0; i < cnt; i++)
+    out[i] = trace[(first + i) % TRACE_CNT];
+  intr_set_level (old_level);
+  return cnt;
+}
+
+/* Prints the I/O trace, oldest request first, and the latency
+   histograms, in the form that utils/disktrace expects:
+
+     disktrace: TICK DISK R|W SECTOR CNT TAG CYCLES
+     disklat: R|W BUCKET COUNT
+
+   Meant for shutdown, when no more requests are coming. */
+void
+disk_print_trace (void)
+{
+  long long first = trace_cnt < TRACE_CNT ? 0 : trace_cnt - TRACE_CNT;
+  long long i;
+  int dir, bucket;
+
+  printf ("disktrace: %lld requests, last %lld follow\n",
+          trace_cnt, trace_cnt - first);
+  for (i = first; i < trace_cnt; i++)
+    {
+      const struct disktrace *t = &trace[i % TRACE_CNT];
+      printf ("disktrace: %lld hd%d:%d %c %u %u %s %u\n",
+              t->tick, t->disk / 2, t->disk % 2, t->write ? 'W' : 'R',
+              t->sector, t->cnt, tag_names[t->tag], t->latency);
+    }
+  for (dir = 0; dir < 2; dir++)
+    for (bucket = 0; bucket < DISK_HIST_CNT; bucket++)
+      if (latency_hist[dir][bucket] != 0)
+        printf ("disklat: %c %d %lld\n", dir ? 'W' : 'R', bucket,
+                latency_hist[dir][bucket]);
 }
 
 /* Returns the disk numbered DEV_NO--either 0 or 1 for master or
@@ -219,21 +535,7 @@ disk_size (struct disk *d)
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) 
 {
-  struct channel *c;
-  
-  ASSERT (d != NULL);
-  ASSERT (buffer != NULL);
-
-  c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  d->read_cnt++;
-  lock_release (&c->lock);
+  disk_read_multiple (d, sec_no, 1, buffer);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -244,23 +546,613 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer)
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer)
 {
-  struct channel *c;
-  
+  disk_write_multiple (d, sec_no, 1, buffer);
+}
+
+/* Returns the CPU's time-stamp counter, which counts cycles. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Returns the number of sectors D transfers per interrupt. */
+static size_t
+block_size (const struct disk *d)
+{
+  return d->multiple > 0 ? d->multiple : 1;
+}
+
+/* Reads the CNT sectors starting at SEC_NO from disk D into
+   BUFFER, which must have room for CNT * DISK_SECTOR_SIZE bytes.
+   CNT must be between 1 and DISK_MULTIPLE_MAX.  The sectors move
+   in a single command, unless the scheduler merges them with
+   other requests into a larger one.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, size_t cnt,
+                    void *buffer)
+{
+  struct disk_request r;
+
+  disk_request_init (&r, d, sec_no, cnt, buffer, false);
+  disk_submit (&r);
+  disk_wait (&r);
+}
+
+/* Writes the CNT sectors starting at SEC_NO on disk D from
+   BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes, as
+   disk_read_multiple().  Returns after the disk has acknowledged
+   receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write_multiple (struct disk *d, disk_sector_t sec_no, size_t cnt,
+                     const void *buffer)
+{
+  struct disk_request r;
+
+  /* The buffer is only read, but disk_request has no const. */
+  disk_request_init (&r, d, sec_no, cnt, (void *) buffer, true);
+  disk_submit (&r);
+  disk_wait (&r);
+}
+
+/* Initializes R as a request to transfer the CNT sectors starting
+   at SEC_NO between disk D and BUFFER, which must be in kernel
+   memory, writing them to D if WRITE is true and reading them
+   otherwise. */
+void
+disk_request_init (struct disk_request *r, struct disk *d,
+                   disk_sector_t sec_no, size_t cnt, void *buffer,
+                   bool write)
+{
   ASSERT (d != NULL);
-  ASSERT (buffer != NULL);
+  ASSERT (buffer != NULL && is_kernel_vaddr (buffer));
+  ASSERT (cnt > 0 && cnt <= DISK_MULTIPLE_MAX);
+  ASSERT (sec_no < d->capacity && cnt <= d->capacity - sec_no);
+
+  r->disk = d;
+  r->sector = sec_no;
+  r->cnt = cnt;
+  r->buffer = buffer;
+  r->write = write;
+  r->tag = thread_current ()->disk_tag;
+  sema_init (&r->done, 0);
+}
+
+/* Queues request R on its disk's channel and returns at once.
+   The caller must not touch R or its buffer until disk_wait (R)
+   returns. */
+void
+disk_submit (struct disk_request *r)
+{
+  struct disk *d = r->disk;
+  struct channel *c = d->channel;
+  int depth;
+
+  if (r->write && d == crash_disk)
+    crash_account (r);
 
-  c = d->channel;
+  r->submit_tick = timer_ticks ();
+  r->submit_tsc = rdtsc ();
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  d->write_cnt++;
+  list_push_back (&c->queue, &r->elem);
+  c->queue_len++;
+  channel_set_busy (c, true);
+  depth = c->queue_len + c->active_cnt;
+  d->request_cnt++;
+  d->depth_sum += depth;
+  if (depth > d->depth_max)
+    d->depth_max = depth;
+  cond_signal (&c->queue_nonempty, &c->lock);
   lock_release (&c->lock);
 }
-
+
+/* Waits for request R, previously submitted, to complete. */
+void
+disk_wait (struct disk_request *r)
+{
+  struct thread *curr = thread_current ();
+
+  curr->wait_reason = WAIT_DISK;
+  sema_down (&r->done);
+  curr->wait_reason = WAIT_OTHER;
+}
+
+/* Counts write request R against the crash budget.  If it goes
+   past the budget, writes just the sectors that fit, as a disk
+   that lost power partway through the command might have, and
+   powers off without another word to the disk.  Any other thread
+   that writes meanwhile never gets to. */
+static void
+crash_account (struct disk_request *r)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t cnt;
+
+  if (crash_thread == thread_current ())
+    {
+      /* The partial write below. */
+      intr_set_level (old_level);
+      return;
+    }
+  if (crash_thread != NULL)
+    {
+      intr_set_level (old_level);
+      sema_down (&crash_sema);
+      NOT_REACHED ();
+    }
+  if ((long long) r->cnt <= crash_budget)
+    {
+      crash_budget -= r->cnt;
+      intr_set_level (old_level);
+      return;
+    }
+  crash_thread = thread_current ();
+  cnt = crash_budget;
+  crash_budget = 0;
+  intr_set_level (old_level);
+
+  if (cnt > 0)
+    {
+      struct disk_request part;
+
+      disk_request_init (&part, r->disk, r->sector, cnt, r->buffer, true);
+      disk_submit (&part);
+      disk_wait (&part);
+    }
+  printf ("Crashing: wrote %zu of %zu sectors at %s sector %"PRDSNu".\n",
+          cnt, r->cnt, r->disk->name, r->sector);
+  crash_power_off ();
+}
+
+/* Simulates a crash once CNT more sectors have been written to
+   disk D: the write that goes past CNT is cut short and the
+   machine powers off, without writing back the file system.
+   Controlled by kernel command-line option "-o crash-after=CNT",
+   for testing crash recovery. */
+void
+disk_crash_after (struct disk *d, long long cnt)
+{
+  enum intr_level old_level;
+
+  ASSERT (cnt >= 0);
+
+  sema_init (&crash_sema, 0);
+  old_level = intr_disable ();
+  crash_budget = cnt;
+  crash_disk = d;
+  intr_set_level (old_level);
+}
+
+/* Returns the tag that disk I/O by the running thread is now
+   attributed to; see disk_set_tag(). */
+enum disk_tag
+disk_get_tag (void)
+{
+  return thread_current ()->disk_tag;
+}
+
+/* Attributes the disk I/O that the running thread causes from
+   now on to TAG, and returns the tag in effect before, which the
+   caller should restore when done, as with intr_set_level():
+
+     enum disk_tag old_tag = disk_set_tag (DISK_TAG_INODE);
+     ...
+     disk_set_tag (old_tag);
+
+   The innermost tag wins, and every thread starts out with
+   DISK_TAG_OTHER. */
+enum disk_tag
+disk_set_tag (enum disk_tag tag)
+{
+  struct thread *curr = thread_current ();
+  enum disk_tag old_tag = curr->disk_tag;
+
+  ASSERT (tag < DISK_TAG_CNT);
+  curr->disk_tag = tag;
+  return old_tag;
+}
+
+/* Chooses the request scheduler called NAME: "fifo", "clook" or
+   "deadline".  Returns false if there is no such scheduler. */
+bool
+disk_set_scheduler (const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < SCHEDULER_CNT; i++)
+    if (!strcmp (schedulers[i].name, name))
+      {
+        scheduler = &schedulers[i];
+        return true;
+      }
+  return false;
+}
+
+/* Request scheduling. */
+
+/* First come, first served. */
+static struct disk_request *
+pick_fifo (struct channel *c)
+{
+  return list_entry (list_front (&c->queue), struct disk_request, elem);
+}
+
+/* C-LOOK: the request nearest ahead of its disk's head, or, if
+   there is none, the lowest-numbered one, so that the head sweeps
+   upward and then returns to the start. */
+static struct disk_request *
+pick_clook (struct channel *c)
+{
+  struct disk_request *best = NULL;
+  disk_sector_t best_key = 0;
+  struct list_elem *e;
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    {
+      struct disk_request *r = list_entry (e, struct disk_request, elem);
+      struct disk *d = r->disk;
+      disk_sector_t key = (r->sector >= d->head
+                           ? r->sector - d->head
+                           : d->capacity + r->sector);
+
+      if (best == NULL || key < best_key)
+        {
+          best = r;
+          best_key = key;
+        }
+    }
+  return best;
+}
+
+/* Returns the oldest queued request on C that writes if WRITE is
+   true or reads otherwise, if it has waited at least DEADLINE
+   ticks, or a null pointer. */
+static struct disk_request *
+expired (struct channel *c, bool write, int64_t deadline)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    {
+      struct disk_request *r = list_entry (e, struct disk_request, elem);
+      if (r->write == write)
+        return timer_elapsed (r->submit_tick) >= deadline ? r : NULL;
+    }
+  return NULL;
+}
+
+/* Deadline: C-LOOK, except that a request that has waited too
+   long goes first, reads, which someone is usually waiting for,
+   having the shorter deadline. */
+static struct disk_request *
+pick_deadline (struct channel *c)
+{
+  struct disk_request *r = expired (c, false, READ_DEADLINE);
+  if (r == NULL)
+    r = expired (c, true, WRITE_DEADLINE);
+  if (r == NULL)
+    r = pick_clook (c);
+  return r;
+}
+
+/* Removes the next request from C's queue, as chosen by the
+   scheduler, into BATCH[0], followed by any queued requests in
+   the same direction for the sectors that follow it on the same
+   disk.  Returns the number of requests taken and stores the
+   number of sectors they cover in *SECTORS.  C's lock must be
+   held. */
+static size_t
+take_batch (struct channel *c, struct disk_request *batch[],
+            size_t *sectors)
+{
+  struct disk_request *first = scheduler->pick (c);
+  struct disk *d = first->disk;
+  size_t cnt = 1;
+  bool merged;
+
+  list_remove (&first->elem);
+  batch[0] = first;
+  *sectors = first->cnt;
+  do
+    {
+      struct list_elem *e;
+
+      merged = false;
+      for (e = list_begin (&c->queue);
+           e != list_end (&c->queue) && cnt < MERGE_MAX;
+           e = list_next (e))
+        {
+          struct disk_request *r = list_entry (e, struct disk_request,
+                                               elem);
+          if (r->disk == d && r->write == first->write
+              && r->sector == first->sector + *sectors
+              && *sectors + r->cnt <= DISK_MULTIPLE_MAX)
+            {
+              list_remove (&r->elem);
+              batch[cnt++] = r;
+              *sectors += r->cnt;
+              merged = true;
+              break;
+            }
+        }
+    }
+  while (merged);
+
+  c->queue_len -= cnt;
+  c->active_cnt = cnt;
+  d->command_cnt++;
+  d->seek_sectors += (first->sector >= d->head
+                      ? first->sector - d->head
+                      : d->head - first->sector);
+  d->head = first->sector + *sectors;
+  return cnt;
+}
+
+/* Records completed request R in the trace and the statistics. */
+static void
+trace_record (const struct disk_request *r)
+{
+  uint64_t cycles = rdtsc () - r->submit_tsc;
+  const struct disk *d = r->disk;
+  struct disktrace *t;
+  enum intr_level old_level;
+  int bucket = 0;
+
+  while (bucket < DISK_HIST_CNT - 1 && cycles >> (bucket + 1) != 0)
+    bucket++;
+
+  old_level = intr_disable ();
+  t = &trace[trace_cnt++ % TRACE_CNT];
+  t->tick = r->submit_tick;
+  t->sector = r->sector;
+  t->cnt = r->cnt;
+  t->disk = (d->channel - channels) * 2 + d->dev_no;
+  t->write = r->write;
+  t->tag = r->tag;
+  t->latency = cycles < UINT_MAX ? cycles : UINT_MAX;
+  tag_cnt[r->tag]++;
+  latency_hist[r->write][bucket]++;
+  intr_set_level (old_level);
+}
+
+/* Marks channel C busy if BUSY is true, idle otherwise, and
+   accounts for the time since the last change.  C's lock must be
+   held. */
+static void
+channel_set_busy (struct channel *c, bool busy)
+{
+  enum intr_level old_level;
+  int64_t now;
+
+  if (c->busy == busy)
+    return;
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  if (busy_channels == CHANNEL_CNT)
+    overlap_ticks += now - busy_change;
+  busy_channels += busy ? 1 : -1;
+  busy_change = now;
+  if (busy)
+    c->busy_start = now;
+  else
+    c->busy_ticks += now - c->busy_start;
+  c->busy = busy;
+  intr_set_level (old_level);
+}
+
+/* Channel dispatcher thread: carries out the requests queued on
+   channel C_, one merged batch at a time.  The channel counts as
+   busy from when a request arrives in an empty queue until the
+   queue drains again. */
+static void
+dispatcher (void *c_)
+{
+  struct channel *c = c_;
+
+  for (;;)
+    {
+      struct disk_request *batch[MERGE_MAX];
+      size_t cnt, sectors, i;
+      struct disk *d;
+      int64_t start;
+      bool ok;
+
+      lock_acquire (&c->lock);
+      if (list_empty (&c->queue))
+        {
+          channel_set_busy (c, false);
+          do
+            cond_wait (&c->queue_nonempty, &c->lock);
+          while (list_empty (&c->queue));
+        }
+      cnt = take_batch (c, batch, &sectors);
+      lock_release (&c->lock);
+
+      d = batch[0]->disk;
+      start = timer_ticks ();
+      ok = (d->dma
+            ? dma_transfer (d, batch, cnt, sectors)
+            : pio_transfer (d, batch, cnt, sectors));
+      if (!ok)
+        PANIC ("%s: disk %s failed, sector=%"PRDSNu, d->name,
+               batch[0]->write ? "write" : "read", batch[0]->sector);
+      d->busy_ticks += timer_elapsed (start);
+      if (batch[0]->write)
+        d->write_cnt += sectors;
+      else
+        d->read_cnt += sectors;
+
+      lock_acquire (&c->lock);
+      c->active_cnt = 0;
+      lock_release (&c->lock);
+      for (i = 0; i < cnt; i++)
+        {
+          trace_record (batch[i]);
+          sema_up (&batch[i]->done);
+        }
+    }
+}
+
+/* Carries out the REQ_CNT requests in BATCH, which cover SECTORS
+   consecutive sectors on disk D, by PIO in one command.  If the
+   disk supports READ/WRITE MULTIPLE, it interrupts once per block
+   of D->multiple sectors rather than once per sector.  Returns
+   false on error. */
+static bool
+pio_transfer (struct disk *d, struct disk_request *batch[],
+              size_t req_cnt, size_t sectors)
+{
+  struct channel *c = d->channel;
+  bool write = batch[0]->write;
+  size_t block = block_size (d);
+  size_t done, r = 0, ofs = 0;
+
+  select_sectors (d, batch[0]->sector, sectors);
+  if (write)
+    issue_pio_command (c, d->multiple > 0 ? CMD_WRITE_MULTIPLE
+                                          : CMD_WRITE_SECTOR_RETRY);
+  else
+    issue_pio_command (c, d->multiple > 0 ? CMD_READ_MULTIPLE
+                                          : CMD_READ_SECTOR_RETRY);
+  for (done = 0; done < sectors; )
+    {
+      size_t n = sectors - done < block ? sectors - done : block;
+
+      if (!write)
+        wait_for_completion (d);
+      if (!wait_while_busy (d))
+        return false;
+      for (; n > 0; n--, done++)
+        {
+          uint8_t *sector = ((uint8_t *) batch[r]->buffer
+                             + ofs * DISK_SECTOR_SIZE);
+          if (write)
+            output_sectors (c, sector, 1);
+          else
+            input_sectors (c, sector, 1);
+          if (++ofs == batch[r]->cnt)
+            {
+              r++;
+              ofs = 0;
+            }
+        }
+      if (write)
+        wait_for_completion (d);
+    }
+  ASSERT (r == req_cnt);
+  return true;
+}
+
+/* Bus-master DMA. */
+
+/* Looks for a PCI IDE controller capable of bus mastering and, if
+   there is one, enables bus mastering on it and returns the base
+   of its bus-master registers.  Returns 0 if there is none. */
+static uint16_t
+find_bus_master (void)
+{
+  struct pci_dev dev;
+  uint32_t bar;
+
+  /* Class 1 is mass storage, subclass 1 IDE.  Bit 7 of the
+     programming interface says it can be a bus master. */
+  if (!pci_find_class (0x01, 0x01, &dev)
+      || !(pci_read_config (&dev, PCI_REG_CLASS) & 0x8000))
+    return 0;
+
+  /* BAR 4 holds the bus-master registers, in I/O space. */
+  bar = pci_read_config (&dev, PCI_REG_BAR (4));
+  if (!(bar & 1) || (bar & 0xfffc) == 0)
+    return 0;
+
+  pci_write_config (&dev, PCI_REG_COMMAND,
+                    pci_read_config (&dev, PCI_REG_COMMAND)
+                    | PCI_CMD_IO | PCI_CMD_MASTER);
+  return bar & 0xfffc;
+}
+
+/* Adds entries to channel C's PRD table, starting at entry I, to
+   cover the SIZE bytes at BUFFER, which must be in kernel memory
+   and so physically contiguous.  Returns the index of the first
+   entry not used. */
+static size_t
+build_prdt (struct channel *c, size_t i, const void *buffer, size_t size)
+{
+  uintptr_t addr = vtop (buffer);
+
+  ASSERT (size > 0);
+
+  while (size > 0)
+    {
+      /* Stop at the next 64 kB boundary. */
+      size_t chunk = 0x10000 - (addr & 0xffff);
+      if (chunk > size)
+        chunk = size;
+
+      ASSERT (i < PRD_CNT);
+      c->prdt[i].addr = addr;
+      c->prdt[i].size = chunk & 0xffff;
+      c->prdt[i].flags = 0;
+      addr += chunk;
+      size -= chunk;
+      i++;
+    }
+  return i;
+}
+
+/* Clears the error and interrupt bits in channel C's bus-master
+   status register, leaving the others alone. */
+static void
+clear_bm_status (struct channel *c)
+{
+  outb (c->bm_base + BM_STATUS,
+        inb (c->bm_base + BM_STATUS) | BM_STA_ERR | BM_STA_INTR);
+}
+
+/* Carries out the REQ_CNT requests in BATCH, which cover SECTORS
+   consecutive sectors on disk D, by bus-master DMA in one
+   command, the controller gathering from or scattering to each
+   request's buffer in turn.  Returns true if successful, false if
+   the disk or the controller reports an error. */
+static bool
+dma_transfer (struct disk *d, struct disk_request *batch[],
+              size_t req_cnt, size_t sectors)
+{
+  struct channel *c = d->channel;
+  bool write = batch[0]->write;
+  uint8_t bm_cmd = write ? 0 : BM_CMD_READ;
+  uint8_t bm_status;
+  size_t i, prd_cnt;
+
+  for (i = prd_cnt = 0; i < req_cnt; i++)
+    prd_cnt = build_prdt (c, prd_cnt, batch[i]->buffer,
+                          batch[i]->cnt * DISK_SECTOR_SIZE);
+  c->prdt[prd_cnt - 1].flags = PRD_EOT;
+  outl (c->bm_base + BM_PRDT, vtop (c->prdt));
+  outb (c->bm_base + BM_COMMAND, bm_cmd);
+  clear_bm_status (c);
+
+  select_sectors (d, batch[0]->sector, sectors);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (c->bm_base + BM_COMMAND, bm_cmd | BM_CMD_START);
+  wait_for_completion (d);
+
+  outb (c->bm_base + BM_COMMAND, bm_cmd);
+  bm_status = inb (c->bm_base + BM_STATUS);
+  clear_bm_status (c);
+  return (!(bm_status & BM_STA_ERR)
+          && !(inb (reg_alt_status (c)) & STA_ERR));
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -381,11 +1273,19 @@ identify_ata_device (struct disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sectors (c, id, 1);
 
   /* Calculate capacity. */
   d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+  /* Word 47 gives the most sectors the disk can transfer per
+     interrupt with READ/WRITE MULTIPLE, if it supports them. */
+  if ((id[47] & 0xff) > 1)
+    set_multiple_mode (d, id[47] & 0xff);
+
+  /* Bit 8 of word 49 says the disk supports DMA. */
+  d->dma = c->bm_base != 0 && (id[49] & (1 << 8)) != 0;
+
   /* Print identification message. */
   printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
   if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -404,6 +1304,23 @@ identify_ata_device (struct disk *d)
   printf ("\"\n");
 }
 
+/* Sends a SET MULTIPLE MODE command to disk D so that READ/WRITE
+   MULTIPLE move SECTORS sectors per interrupt, and records the
+   setting in D if the disk accepts it. */
+static void
+set_multiple_mode (struct disk *d, int sectors)
+{
+  struct channel *c = d->channel;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), sectors);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+    d->multiple = sectors;
+}
+
 /* Prints STRING, which consists of SIZE bytes in a funky format:
    each pair of bytes is in reverse order.  Does not print
    trailing whitespace and/or nulls. */
@@ -426,18 +1343,19 @@ print_ata_string (char *string, size_t size)
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT to the disk's sector selection and count
+   registers.  (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) 
+select_sectors (struct disk *d, disk_sector_t sec_no, size_t cnt) 
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < d->capacity);
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= DISK_MULTIPLE_MAX);
+  ASSERT (sec_no < d->capacity && cnt <= d->capacity - sec_no);
+  ASSERT (sec_no + cnt <= (1UL << 28));
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == 256 ? 0 : cnt);   /* 0 means 256. */
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -446,7 +1364,8 @@ select_sector (struct disk *d, disk_sector_t sec_no)
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
-   completion interrupt. */
+   completion interrupt.  Despite the name, also used for DMA
+   commands. */
 static void
 issue_pio_command (struct channel *c, uint8_t command) 
 {
@@ -458,20 +1377,35 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for DISK_SECTOR_SIZE bytes. */
+/* Blocks until the completion interrupt for disk D's channel
+   arrives, charging the time to disk I/O in the caller's
+   accounting. */
+static void
+wait_for_completion (struct disk *d)
+{
+  struct thread *curr = thread_current ();
+
+  curr->wait_reason = WAIT_DISK;
+  sema_down (&d->channel->completion_wait);
+  curr->wait_reason = WAIT_OTHER;
+  d->intr_cnt++;
+}
+
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTORS, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector) 
+input_sectors (struct channel *c, void *sectors, size_t cnt) 
 {
-  insw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sectors, cnt * DISK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain DISK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors from SECTORS to channel C's data register in
+   PIO mode.  SECTORS must contain CNT * DISK_SECTOR_SIZE bytes. */
 static void
-output_sector (struct channel *c, const void *sector) 
+output_sectors (struct channel *c, const void *sectors, size_t cnt) 
 {
-  outsw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sectors, cnt * DISK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
@@ -1,8 +1,13 @@
 #ifndef DEVICES_DISK_H
 #define DEVICES_DISK_H
 
+#include <diskstat.h>
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* Size of a disk sector in bytes. */
 #define DISK_SECTOR_SIZE 512
@@ -15,12 +20,58 @@ typedef uint32_t disk_sector_t;
    printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* Most sectors a single disk_read_multiple() or
+   disk_write_multiple() call can transfer. */
+#define DISK_MULTIPLE_MAX 256
+
+/* A request to transfer sectors to or from a disk, queued with
+   disk_submit() and finished when disk_wait() returns. */
+struct disk_request
+  {
+    struct disk *disk;          /* Disk to transfer to or from. */
+    disk_sector_t sector;       /* First sector. */
+    size_t cnt;                 /* Number of sectors. */
+    void *buffer;               /* CNT * DISK_SECTOR_SIZE bytes. */
+    bool write;                 /* Write to the disk, or read from it? */
+    enum disk_tag tag;          /* What it is for. */
+
+    /* Owned by devices/disk.c. */
+    struct list_elem elem;      /* Element in channel's queue. */
+    int64_t submit_tick;        /* When submitted. */
+    uint64_t submit_tsc;        /* When submitted, in CPU cycles. */
+    struct semaphore done;      /* Up'd on completion. */
+  };
+
+/* Use bus-master DMA where the controller supports it?
+   Controlled by kernel command-line option "-nodma". */
+extern bool disk_use_dma;
+
+/* Print the disk I/O trace at shutdown?
+   Controlled by kernel command-line option "-dtrace". */
+extern bool disk_trace_dump;
+
 void disk_init (void);
 void disk_print_stats (void);
+void disk_get_stats (struct diskstat *);
+int disk_get_trace (struct disktrace *, int max);
+void disk_print_trace (void);
 
 struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
+void disk_read_multiple (struct disk *, disk_sector_t, size_t cnt, void *);
+void disk_write_multiple (struct disk *, disk_sector_t, size_t cnt,
+                          const void *);
+
+void disk_request_init (struct disk_request *, struct disk *,
+                        disk_sector_t, size_t cnt, void *buffer,
+                        bool write);
+void disk_submit (struct disk_request *);
+void disk_wait (struct disk_request *);
+bool disk_set_scheduler (const char *name);
+enum disk_tag disk_set_tag (enum disk_tag);
+enum disk_tag disk_get_tag (void);
+void disk_crash_after (struct disk *, long long cnt);
 
 #endif /* devices/disk.h */
@@ -0,0 +1,86 @@
+#include "devices/pci.h"
+#include <debug.h>
+#include "threads/io.h"
+
+/* Access to PCI configuration space through configuration
+   mechanism #1, the pair of I/O ports found on every PC since
+   the PCI 2.0 days.  This is just enough to find a device by
+   class and program it. */
+
+#define PCI_CONFIG_ADDR 0xcf8   /* Configuration address port. */
+#define PCI_CONFIG_DATA 0xcfc   /* Configuration data port. */
+
+#define PCI_BUS_CNT 256         /* Buses to scan. */
+#define PCI_DEV_CNT 32          /* Devices per bus. */
+#define PCI_FUNC_CNT 8          /* Functions per device. */
+
+/* Selects register REG of function D for the next access to
+   PCI_CONFIG_DATA. */
+static void
+select_register (const struct pci_dev *d, uint8_t reg)
+{
+  outl (PCI_CONFIG_ADDR, (1u << 31) | ((uint32_t) d->bus << 16)
+        | ((uint32_t) d->dev << 11) | ((uint32_t) d->func << 8)
+        | (reg & 0xfc));
+}
+
+/* Returns the 32-bit configuration register REG of function D.
+   REG must be a multiple of 4. */
+uint32_t
+pci_read_config (const struct pci_dev *d, uint8_t reg)
+{
+  ASSERT (reg % 4 == 0);
+
+  select_register (d, reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Sets the 32-bit configuration register REG of function D to
+   VALUE.  REG must be a multiple of 4. */
+void
+pci_write_config (const struct pci_dev *d, uint8_t reg, uint32_t value)
+{
+  ASSERT (reg % 4 == 0);
+
+  select_register (d, reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Scans the PCI buses for the first function with the given
+   CLASS and SUBCLASS codes.  If there is one, stores its
+   position in *D and returns true; otherwise returns false. */
+bool
+pci_find_class (uint8_t class, uint8_t subclass, struct pci_dev *d)
+{
+  int bus, dev, func;
+
+  for (bus = 0; bus < PCI_BUS_CNT; bus++)
+    for (dev = 0; dev < PCI_DEV_CNT; dev++)
+      for (func = 0; func < PCI_FUNC_CNT; func++)
+        {
+          uint32_t class_reg;
+
+          d->bus = bus;
+          d->dev = dev;
+          d->func = func;
+          if ((pci_read_config (d, PCI_REG_ID) & 0xffff) == 0xffff)
+            {
+              /* No such function.  If function 0 is missing, so is
+                 the whole device. */
+              if (func == 0)
+                break;
+              continue;
+            }
+
+          class_reg = pci_read_config (d, PCI_REG_CLASS);
+          if ((class_reg >> 24) == class
+              && ((class_reg >> 16) & 0xff) == subclass)
+            return true;
+
+          /* Only multi-function devices have functions past 0. */
+          if (func == 0
+              && !(pci_read_config (d, PCI_REG_HEADER) & 0x00800000))
+            break;
+        }
+  return false;
+}
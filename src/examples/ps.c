@@ -0,0 +1,61 @@
+/* ps.c
+
+   Prints per-thread scheduling and CPU accounting for every
+   live thread: time spent running, waiting on the ready queue,
+   and blocked (split by wait reason), plus voluntary and
+   involuntary context switches.  All times are in timer ticks. */
+
+#include <stdio.h>
+#include <syscall.h>
+
+#define MAX_THREADS 64
+
+static struct procstat stats[MAX_THREADS];
+
+static const char *
+status_name (int status)
+{
+  static const char *names[PROCSTAT_STATUS_CNT] =
+    {"run", "ready", "block", "dying"};
+  return status >= 0 && status < PROCSTAT_STATUS_CNT ? names[status] : "?";
+}
+
+static const char *
+wait_name (int reason)
+{
+  static const char *names[WAIT_REASON_CNT] =
+    {"other", "sema", "lock", "disk", "sleep"};
+  return reason >= 0 && reason < WAIT_REASON_CNT ? names[reason] : "?";
+}
+
+int
+main (void)
+{
+  int cnt = procstat (stats, MAX_THREADS);
+  int i;
+
+  if (cnt < 0)
+    {
+      printf ("ps: procstat failed\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("%4s %-15s %-5s %-5s %7s %7s %7s %7s %7s %7s %7s %6s %6s\n",
+          "TID", "NAME", "STAT", "WAIT", "RUN", "READY",
+          "LOCK", "SEMA", "DISK", "SLEEP", "OTHER", "VOLCS", "INVCS");
+  for (i = 0; i < cnt; i++)
+    {
+      struct procstat *ps = &stats[i];
+      printf ("%4d %-15s %-5s %-5s %7lld %7lld %7lld %7lld %7lld %7lld "
+              "%7lld %6u %6u\n",
+              ps->tid, ps->name, status_name (ps->status),
+              (ps->status == PROCSTAT_BLOCKED
+               ? wait_name (ps->wait_reason) : "-"),
+              ps->run_ticks, ps->ready_ticks,
+              ps->blocked_ticks[WAIT_LOCK], ps->blocked_ticks[WAIT_SEMA],
+              ps->blocked_ticks[WAIT_DISK], ps->blocked_ticks[WAIT_SLEEP],
+              ps->blocked_ticks[WAIT_OTHER],
+              ps->voluntary_switches, ps->involuntary_switches);
+    }
+  return EXIT_SUCCESS;
+}
@@ -1,12 +1,17 @@
 #include <debug.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <list.h>
 #include "filesys/cache.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/synch.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "devices/timer.h"
 
 
@@ -15,6 +20,34 @@ struct disk *filesys_disk;
 // struct bitmap *cache_map; //FIXME: we need it?
 struct semaphore cache_sema;
 
+/* Sectors read ahead of a cache miss, in the same disk command. */
+#define CACHE_READ_AHEAD 7
+
+/* Most dirty sectors written back at a time, whether by one pass
+   of cache_rewrite_disk() or around an evicted entry. */
+#define CACHE_FLUSH_MAX 32
+
+/* Bounce buffer for read-ahead and journal commits, which each
+   need several sectors in one buffer although cache entries are
+   not contiguous.  Write-back does not use it: evicting entries
+   for read-ahead writes some back while the bounce buffer holds
+   sectors just read.  MAX_CACHE_SIZE sectors long.  Protected by
+   cache_sema. */
+#define CACHE_BOUNCE_PAGES (MAX_CACHE_SIZE * DISK_SECTOR_SIZE / PGSIZE)
+static uint8_t *cache_bounce;
+
+/* Entries pinned for the running journal transaction, at most
+   JOURNAL_TXN_MAX.  Protected by cache_sema. */
+static size_t pinned_cnt;
+
+/* Write-back statistics, protected by cache_sema. */
+static long long flush_sectors;     /* Dirty sectors written. */
+static long long flush_runs;        /* Runs of consecutive sectors
+                                       among them. */
+
+static void cache_flush_around(struct cache_entry *cache);
+static void cache_commit_locked(bool forced);
+
 void cache_init()
 {
   int i;
@@ -31,7 +64,8 @@ void cache_init()
     cache->modified = false;
     list_push_back(&buffer_cache_list, &(cache->elem));
   }
-  sema_init(&cache_sema, 1);
+  cache_bounce = palloc_get_multiple(PAL_ASSERT, CACHE_BOUNCE_PAGES);
+  sema_init_named(&cache_sema, 1, "cache_sema");
   thread_create("cache_rewrite", 0, cache_periodic_rewrite, NULL);
 }
 
@@ -80,24 +114,87 @@ cache_get_free() //function name 바꾸고 싶은데 뭐가 적절할까
 }
 
 
-/* Evict first cache entry from the buffer_cache_list. */
+/* Evict first cache entry from the buffer_cache_list that is not
+   pinned by the journal.  If it is dirty, the dirty entries for
+   the sectors around it are written back along with it. */
 void cache_evict()
 {
   //FIFO
-  struct cache_entry *cache;
+  struct cache_entry *cache = NULL;
   struct list_elem *e;
   
-  e = list_pop_front(&buffer_cache_list);
-  cache = list_entry(e, struct cache_entry, elem);
+  for(e = list_begin(&buffer_cache_list); e != list_end(&buffer_cache_list); e = list_next(e))
+  {
+    cache = list_entry(e, struct cache_entry, elem);
+    if(!cache->pinned)
+      break;
+  }
+  ASSERT(e != list_end(&buffer_cache_list));
+
+  /* CACHE must still be in the list for cache_flush_around() to
+     find it among the dirty entries. */
   if(cache->modified)
   {
-    disk_write(filesys_disk, cache->sector_num, cache->addr);
+    enum disk_tag old_tag = disk_set_tag(DISK_TAG_EVICT);
+    cache_flush_around(cache);
+    disk_set_tag(old_tag);
   }
+  list_remove(e);
   free(cache->addr);
   free(cache);
 }
 
 
+/* Return an entry for SECTOR, taking a free one or evicting the
+   oldest.  The caller fills in its data. */
+static struct cache_entry*
+cache_take(disk_sector_t sector)
+{
+  struct cache_entry *cache = cache_get_free();
+
+  if(cache == NULL)
+  {
+    cache_evict();
+    cache = calloc(1, sizeof (struct cache_entry));
+    cache->addr = malloc(DISK_SECTOR_SIZE);
+    list_push_back(&buffer_cache_list, &cache->elem);
+  }
+  cache->has_data = true;
+  cache->modified = false;
+  cache->pinned = false;
+  cache->sector_num = sector;
+  return cache;
+}
+
+/* Fill new entry CACHE from disk, along with up to
+   CACHE_READ_AHEAD following sectors that are not cached yet,
+   all in one disk command. */
+static void
+cache_fetch(struct cache_entry *cache)
+{
+  disk_sector_t sector = cache->sector_num;
+  size_t cnt = 1, i;
+
+  while(cnt <= CACHE_READ_AHEAD
+        && sector + cnt < disk_size(filesys_disk)
+        && cache_search(sector + cnt) == NULL)
+    cnt++;
+
+  disk_read_multiple(filesys_disk, sector, cnt, cache_bounce);
+  memcpy(cache->addr, cache_bounce, DISK_SECTOR_SIZE);
+
+  /* Move CACHE behind the evictions below, since the caller is
+     about to use it. */
+  list_remove(&cache->elem);
+  list_push_back(&buffer_cache_list, &cache->elem);
+  for(i = 1; i < cnt; ++i)
+  {
+    struct cache_entry *ahead = cache_take(sector + i);
+    memcpy(ahead->addr, cache_bounce + i * DISK_SECTOR_SIZE,
+           DISK_SECTOR_SIZE);
+  }
+}
+
 /* Read from cache instead of disk. */
 void cache_read(disk_sector_t sector, void *buffer)
 {
@@ -115,6 +212,7 @@ void cache_read(disk_sector_t sector, void *buffer)
       new_cache = calloc(1, sizeof (struct cache_entry));
       new_cache->has_data = true;
       new_cache->modified = false;
+      new_cache->pinned = false;
       new_cache->sector_num = sector;
       new_cache->addr = malloc(DISK_SECTOR_SIZE);
 
@@ -124,11 +222,12 @@ void cache_read(disk_sector_t sector, void *buffer)
     {
       new_cache->has_data = true;
       new_cache->modified = false;
+      new_cache->pinned = false;
       new_cache->sector_num = sector;
       new_cache->addr = malloc(DISK_SECTOR_SIZE);
     }
-    //fetch from disk
-    disk_read(filesys_disk, new_cache->sector_num, new_cache->addr);
+    //fetch from disk, with read-ahead
+    cache_fetch(new_cache);
     //read from cache
     memcpy(buffer, new_cache->addr, DISK_SECTOR_SIZE);
   }
@@ -141,13 +240,23 @@ void cache_read(disk_sector_t sector, void *buffer)
   sema_up(&cache_sema);
 }
 
-/* Write at cache instead of disk. */
+/* Write at cache instead of disk.  File system metadata is
+   pinned in the cache until the journal has it. */
 void cache_write(disk_sector_t sector, void *buffer)
 {
   sema_down(&cache_sema);
   struct cache_entry *find_cache = cache_search(sector);
+  struct cache_entry *cache;
+  bool log = journal_wants(sector);
 
-  if(!find_cache)  //cache miss => fetch to cache from disk
+  /* Make room in the running transaction first, before this
+     change is in the cache where a checkpoint could write it
+     back. */
+  if(log && (find_cache == NULL || !find_cache->pinned)
+     && pinned_cnt >= JOURNAL_TXN_MAX)
+    cache_commit_locked(true);
+
+  if(!find_cache)  //cache miss => take a new entry
   {
     struct cache_entry *new_cache = cache_get_free();
     if(new_cache==NULL)
@@ -156,6 +265,7 @@ void cache_write(disk_sector_t sector, void *buffer)
       new_cache = calloc(1, sizeof (struct cache_entry));
       new_cache->has_data = true;
       new_cache->modified = false;
+      new_cache->pinned = false;
       new_cache->sector_num = sector;
       new_cache->addr = malloc(DISK_SECTOR_SIZE);
       // PANIC('write - 왜 뉴캐시가 없냐\n');
@@ -166,60 +276,255 @@ void cache_write(disk_sector_t sector, void *buffer)
     {
       new_cache->has_data = true;
       new_cache->modified = false;
+      new_cache->pinned = false;
       new_cache->sector_num = sector;
       new_cache->addr = malloc(DISK_SECTOR_SIZE);
     }
-    //fetch to cache form disk
-    disk_read(filesys_disk, new_cache->sector_num, new_cache->addr);
-    //write at cache
+    /* The whole sector is overwritten, so there is no need to
+       read it from disk first. */
     memcpy(new_cache->addr, buffer, DISK_SECTOR_SIZE);
     new_cache->modified = true;
+    cache = new_cache;
   }
   else    //cache hit => write at cache
   {
     memcpy(find_cache->addr, buffer, DISK_SECTOR_SIZE);
     find_cache->modified = true;
+    cache = find_cache;
+  }
+  if(log && !cache->pinned)
+  {
+    cache->pinned = true;
+    pinned_cnt++;
   }
 
   sema_up(&cache_sema);
 }
 
 
-/* Periodically rewrite the cache back to disk, using timer_sleep(). */
+/* Periodically rewrite the cache back to disk, using timer_sleep().
+   Open inodes' delayed blocks get their sectors first, and the
+   journal commits, so that the metadata goes out in the same
+   pass. */
 void cache_periodic_rewrite()
 {
   //busy waiting
   while(true)
   {
     timer_sleep(5 * TIMER_FREQ);
+    inode_flush_all();
+    journal_commit();
     cache_rewrite_disk();
   }
   printf("this works!\n");
 }
 
-/* Write back all the cached data to disk. */
-void cache_rewrite_disk()
+/* Order cache entries by sector, for qsort(). */
+static int
+cache_sector_cmp(const void *a_, const void *b_)
 {
-  sema_down(&cache_sema);
-  struct cache_entry *cache;
+  const struct cache_entry *a = *(struct cache_entry *const *) a_;
+  const struct cache_entry *b = *(struct cache_entry *const *) b_;
+
+  return a->sector_num < b->sector_num ? -1 : a->sector_num > b->sector_num;
+}
+
+/* Store the dirty entries that are not pinned by the journal into
+   DIRTY, sorted by sector, and return how many there are. */
+static size_t
+cache_collect_dirty(struct cache_entry **dirty)
+{
+  size_t cnt = 0;
   struct list_elem *e;
 
-  if(!list_empty(&buffer_cache_list))
+  for(e = list_begin(&buffer_cache_list); e != list_end(&buffer_cache_list); e = list_next(e))
   {
-    for(e = list_begin(&buffer_cache_list); e != list_end(&buffer_cache_list); e = list_next(e))
+    struct cache_entry *cache = list_entry(e, struct cache_entry, elem);
+    if(cache->has_data && cache->modified && !cache->pinned)
     {
-      cache = list_entry(e, struct cache_entry, elem);
-      if(cache->modified == true)
-      {
-        disk_write(filesys_disk, cache->sector_num, cache->addr);
-        cache->modified = false;
-      }
+      ASSERT(cnt < MAX_CACHE_SIZE);
+      dirty[cnt++] = cache;
     }
   }
+  qsort(dirty, cnt, sizeof *dirty, cache_sector_cmp);
+  return cnt;
+}
+
+/* Write back the CNT dirty entries in DIRTY, which must be sorted
+   by sector.  Each entry goes out straight from its own buffer as
+   a request of its own, and all of them are queued, in order,
+   before waiting for any, so that the disk scheduler merges each
+   run of consecutive sectors into as few commands as it can. */
+static void
+cache_flush(struct cache_entry **dirty, size_t cnt)
+{
+  static struct disk_request reqs[MAX_CACHE_SIZE];
+  size_t i;
+
+  ASSERT(cnt <= MAX_CACHE_SIZE);
+
+  for(i = 0; i < cnt; ++i)
+  {
+    if(i == 0 || dirty[i]->sector_num != dirty[i - 1]->sector_num + 1)
+      flush_runs++;
+    disk_request_init(&reqs[i], filesys_disk, dirty[i]->sector_num, 1,
+                      dirty[i]->addr, true);
+    disk_submit(&reqs[i]);
+    dirty[i]->modified = false;
+  }
+  for(i = 0; i < cnt; ++i)
+    disk_wait(&reqs[i]);
+
+  flush_sectors += cnt;
+}
+
+/* Write back the dirty entry CACHE, which is being evicted,
+   together with the dirty entries for the sectors around it, as
+   one run. */
+static void
+cache_flush_around(struct cache_entry *cache)
+{
+  struct cache_entry *dirty[MAX_CACHE_SIZE];
+  size_t cnt = cache_collect_dirty(dirty);
+  size_t first, last;
+
+  for(first = 0; dirty[first] != cache; ++first)
+    ASSERT(first + 1 < cnt);
+  last = first;
+  while(first > 0 && last - first + 1 < CACHE_FLUSH_MAX
+        && dirty[first - 1]->sector_num + 1 == dirty[first]->sector_num)
+    first--;
+  while(last + 1 < cnt && last - first + 1 < CACHE_FLUSH_MAX
+        && dirty[last + 1]->sector_num == dirty[last]->sector_num + 1)
+    last++;
+  cache_flush(dirty + first, last - first + 1);
+}
+
+/* Write back up to CACHE_FLUSH_MAX dirty entries, lowest sectors
+   first, and return how many. */
+static size_t
+cache_rewrite_pass(void)
+{
+  struct cache_entry *dirty[MAX_CACHE_SIZE];
+  size_t cnt;
 
+  sema_down(&cache_sema);
+  enum disk_tag old_tag = disk_set_tag(DISK_TAG_WRITEBACK);
+  cnt = cache_collect_dirty(dirty);
+  if(cnt > CACHE_FLUSH_MAX)
+    cnt = CACHE_FLUSH_MAX;
+  cache_flush(dirty, cnt);
+  disk_set_tag(old_tag);
   sema_up(&cache_sema);
+  return cnt;
+}
+
+/* Write back all the cached data to disk.  This goes in passes of
+   at most CACHE_FLUSH_MAX sectors, letting other cache users in
+   between, so that a big write-back does not hold them up for
+   long at a stretch. */
+void cache_rewrite_disk()
+{
+  while(cache_rewrite_pass() > 0)
+    continue;
+}
+
+/* Write back every dirty entry that is not pinned, holding
+   cache_sema throughout. */
+static void
+cache_rewrite_locked(void)
+{
+  struct cache_entry *dirty[MAX_CACHE_SIZE];
+  size_t cnt;
+
+  while((cnt = cache_collect_dirty(dirty)) > 0)
+    cache_flush(dirty, cnt < CACHE_FLUSH_MAX ? cnt : CACHE_FLUSH_MAX);
 }
 
+/* Write back everything the journal's log covers and empty the
+   log.  There must be no running transaction. */
+static void
+cache_checkpoint_locked(void)
+{
+  enum disk_tag old_tag = disk_set_tag(DISK_TAG_WRITEBACK);
+
+  ASSERT(pinned_cnt == 0);
+  cache_rewrite_locked();
+  journal_checkpoint();
+  disk_set_tag(old_tag);
+}
 
+/* Commit the running transaction: log the pinned entries, which
+   may then be written back like any other.  If the log could not
+   take another full transaction after this one, checkpoint it
+   now, while nothing is pinned.  FORCED says whether operations
+   may still be in progress. */
+static void
+cache_commit_locked(bool forced)
+{
+  disk_sector_t sectors[JOURNAL_TXN_MAX];
+  size_t cnt = 0;
+  struct list_elem *e;
 
+  ASSERT(pinned_cnt <= JOURNAL_TXN_MAX);
+  if(pinned_cnt == 0)
+    return;
 
+  for(e = list_begin(&buffer_cache_list); e != list_end(&buffer_cache_list); e = list_next(e))
+  {
+    struct cache_entry *cache = list_entry(e, struct cache_entry, elem);
+    if(cache->pinned)
+    {
+      sectors[cnt] = cache->sector_num;
+      memcpy(cache_bounce + ++cnt * DISK_SECTOR_SIZE, cache->addr,
+             DISK_SECTOR_SIZE);
+      cache->pinned = false;
+    }
+  }
+  ASSERT(cnt == pinned_cnt);
+  pinned_cnt = 0;
+  journal_write(cnt, sectors, cache_bounce, forced);
+
+  if(!journal_has_room(JOURNAL_TXN_MAX))
+    cache_checkpoint_locked();
+}
+
+/* Commit the running journal transaction.  Called by the journal
+   when no operation is in progress. */
+void cache_commit()
+{
+  sema_down(&cache_sema);
+  cache_commit_locked(false);
+  sema_up(&cache_sema);
+}
+
+/* Commit whatever is pinned, write back all the cached data and
+   empty the journal, so that there is nothing to replay on the
+   next boot. */
+void cache_checkpoint()
+{
+  sema_down(&cache_sema);
+  cache_commit_locked(false);
+  cache_checkpoint_locked();
+  sema_up(&cache_sema);
+}
+
+/* Return how many entries the running journal transaction has
+   pinned.  Just a hint, read without cache_sema. */
+size_t cache_pinned_cnt()
+{
+  return pinned_cnt;
+}
+
+/* Print write-back statistics. */
+void cache_print_stats()
+{
+  printf("Cache: %lld sectors written back in %lld runs",
+         flush_sectors, flush_runs);
+  if(flush_sectors > 0)
+  {
+    long long hundredths = flush_runs * 100 / flush_sectors;
+    printf(" (%lld.%02lld per sector)", hundredths / 100, hundredths % 100);
+  }
+  printf("\n");
+}
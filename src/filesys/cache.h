@@ -12,6 +12,8 @@ struct cache_entry
   disk_sector_t sector_num;   /* Disk sector number which this cached data came from. */ 
   bool has_data;      /* True if this entry has cached data. - valid bit */
   bool modified;     /* True if this data has been modified. - dirty bit */
+  bool pinned;       /* Changed by the running journal transaction, so kept
+                        from write-back until it is committed. */
   struct list_elem elem;    /* List element for buffer_cache list. */
 };
 
@@ -27,3 +29,7 @@ void cache_write(disk_sector_t sector, void *buffer);
 
 void cache_periodic_rewrite();
 void cache_rewrite_disk();
+void cache_commit();
+void cache_checkpoint();
+size_t cache_pinned_cnt();
+void cache_print_stats();
@@ -6,6 +6,8 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/cache.h"
+#include "filesys/journal.h"
 #include "devices/disk.h"
 
 #include "threads/thread.h"
@@ -27,6 +29,7 @@ filesys_init (bool format)
   if (filesys_disk == NULL)
     PANIC ("hd0:1 (hdb) not present, file system initialization failed");
   cache_init();
+  journal_init (format);
   inode_init ();
   free_map_init ();
 
@@ -44,7 +47,9 @@ filesys_init (bool format)
 void
 filesys_done (void)
 {
+  inode_flush_all ();
   free_map_close ();
+  cache_checkpoint ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -63,6 +68,7 @@ filesys_create (const char *name, off_t initial_size, bool is_dir)
   struct dir *dir = path_to_dir(name_, file_name);
   bool success = false;
 
+  journal_begin ();
     success = (dir != NULL
                   && free_map_allocate (1, &inode_sector)
                   && inode_create (inode_sector, initial_size, is_dir)
@@ -71,6 +77,7 @@ filesys_create (const char *name, off_t initial_size, bool is_dir)
   if (!success && inode_sector != 0)
     free_map_release (inode_sector, 1);
   dir_close (dir);
+  journal_end ();
 
   return success;
 }
@@ -113,10 +120,12 @@ filesys_remove (const char *name)
 
   struct dir *dir = path_to_dir(name_, file_name);
 
+  journal_begin ();
   bool success = dir != NULL && dir_remove (dir, file_name);
   //dir_close (dir);
 
   dir_close(dir);
+  journal_end ();
   palloc_free_page(name_);
   palloc_free_page(file_name);
 
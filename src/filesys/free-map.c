@@ -4,9 +4,14 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static struct lock free_map_lock;    /* Guards the two below. */
+static size_t reserved_cnt;          /* Free sectors set aside by
+                                        free_map_reserve(). */
 
 /* Initializes the free map. */
 void
@@ -17,14 +22,15 @@ free_map_init (void)
     PANIC ("bitmap creation failed--disk is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTOR_CNT, true);
+  lock_init (&free_map_lock);
 }
 
-/* Allocates CNT consecutive sectors from the free map and stores
-   the first into *SECTORP.
-   Returns true if successful, false if all sectors were
-   available. */
-bool
-free_map_allocate (size_t cnt, disk_sector_t *sectorp) 
+/* Allocates CNT consecutive sectors and stores the first into
+   *SECTORP, which FREE_MAP_LOCK must be held for.  Returns true
+   if successful. */
+static bool
+allocate (size_t cnt, disk_sector_t *sectorp)
 {
   disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
@@ -39,13 +45,89 @@ free_map_allocate (size_t cnt, disk_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
+/* Returns the number of free sectors not set aside by
+   free_map_reserve().  FREE_MAP_LOCK must be held. */
+static size_t
+unreserved_cnt (void)
+{
+  size_t free_cnt;
+
+  if (reserved_cnt == 0)
+    return bitmap_size (free_map);
+  free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
+  return free_cnt > reserved_cnt ? free_cnt - reserved_cnt : 0;
+}
+
+/* Allocates CNT consecutive sectors from the free map and stores
+   the first into *SECTORP.  Sectors set aside by
+   free_map_reserve() are left alone.
+   Returns true if successful, false if not enough sectors were
+   available. */
+bool
+free_map_allocate (size_t cnt, disk_sector_t *sectorp) 
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = unreserved_cnt () >= cnt && allocate (cnt, sectorp);
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Like free_map_allocate(), but takes the CNT sectors out of
+   those set aside by earlier calls to free_map_reserve(), which
+   must add up to at least CNT.  The reservation shrinks by CNT
+   only if successful; the sectors set aside need not be
+   consecutive, so that is not guaranteed. */
+bool
+free_map_allocate_reserved (size_t cnt, disk_sector_t *sectorp)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  ASSERT (reserved_cnt >= cnt);
+  success = allocate (cnt, sectorp);
+  if (success)
+    reserved_cnt -= cnt;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Sets aside CNT free sectors, so that free_map_allocate() leaves
+   them for free_map_allocate_reserved().  Returns false, setting
+   nothing aside, if there are not that many. */
+bool
+free_map_reserve (size_t cnt)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = unreserved_cnt () >= cnt;
+  if (success)
+    reserved_cnt += cnt;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Gives back CNT sectors set aside by free_map_reserve(). */
+void
+free_map_unreserve (size_t cnt)
+{
+  lock_acquire (&free_map_lock);
+  ASSERT (reserved_cnt >= cnt);
+  reserved_cnt -= cnt;
+  lock_release (&free_map_lock);
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
   bitmap_write (free_map, free_map_file);
+  lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
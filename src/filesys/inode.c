@@ -2,11 +2,18 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/cache.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#endif
 
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -23,38 +30,131 @@ MIN (size_t a, size_t b)
   return a < b ? a : b;
 }
 
-bool inode_indexed_allocate(struct inode_disk *disk_inode);
-bool inode_grow(struct inode_disk *disk_inode, off_t length);
-disk_sector_t inode_index_to_sector(const struct inode_disk *idisk, off_t index);
+/* How inode_index_to_sector() fills in a hole. */
+struct sector_alloc
+  {
+    bool allocated;             /* Set if anything was allocated. */
+    size_t *reserve;            /* Reserved sectors to draw on, or null
+                                   to use free_map_allocate(). */
+    disk_sector_t data;         /* Data sector to put in the hole, or 0
+                                   to allocate one.  Reset to 0 once
+                                   it has been used. */
+  };
+
+/* A write to a hole in a plain file, waiting in memory for a disk
+   sector. */
+struct delayed_block
+  {
+    struct list_elem elem;      /* Element in inode's `delayed'. */
+    off_t index;                /* Sector index within the file. */
+    uint8_t data[DISK_SECTOR_SIZE]; /* Contents. */
+  };
+
+/* Most delayed blocks held by one inode, and by all of them, before
+   a write flushes its own inode. */
+#define DELAY_MAX 64
+#define DELAY_TOTAL_MAX 256
+
+/* Delayed blocks across all inodes.  Updated with interrupts off. */
+static size_t delay_total;
+
+/* Statistics. */
+static long long inode_write_cnt;       /* In-memory inodes written back. */
+static long long alloc_sector_cnt;      /* Sectors allocated. */
+static long long alloc_call_cnt;        /* Free map updates doing so. */
+static long long delay_block_cnt;       /* Blocks allocated delayed... */
+static long long delay_batch_cnt;       /* ...in this many batches. */
+
+static bool inode_allocate (struct inode_disk *, off_t length);
+static disk_sector_t inode_index_to_sector (struct inode_disk *,
+                                            off_t index,
+                                            struct sector_alloc *);
+static void inode_free (struct inode *);
+static struct delayed_block *delay_find (struct inode *, off_t index);
+static struct delayed_block *delay_add (struct inode *, off_t index);
+static void inode_write_back (struct inode *);
+static void inode_flush (struct inode *);
+static void inode_discard_delayed (struct inode *);
 
 
 /* Returns the disk sector that contains byte offset POS within
-   INODE.
+   INODE, or 0 if POS lies in a hole.
    Returns -1 if INODE does not contain data for a byte at offset
    POS. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos)
+byte_to_sector (struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
   if (pos < inode->data.length)
   {
     // return inode->data.start + pos / DISK_SECTOR_SIZE;  //base filesytem
     off_t index = pos / DISK_SECTOR_SIZE;
-    return inode_index_to_sector(&inode->data, index);
+    enum disk_tag old_tag = disk_set_tag (DISK_TAG_INODE);
+    disk_sector_t sector = inode_index_to_sector (&inode->data, index,
+                                                  NULL);
+    disk_set_tag (old_tag);
+    return sector;
   }
   else
     return -1;
 }
 
+/* Returns the tag for disk I/O on INODE's data: the free map and
+   directories are told apart from plain file data. */
+static enum disk_tag
+inode_data_tag (const struct inode *inode)
+{
+  if (inode->sector == FREE_MAP_SECTOR)
+    return DISK_TAG_FREE_MAP;
+  else if (inode->data.is_dir)
+    return DISK_TAG_DIR;
+  else
+    return DISK_TAG_DATA;
+}
+
+#ifdef VM
+/* Returns true if INODE's data goes through the page cache.  The
+   free map and directories are read in small pieces, by the
+   kernel alone, and stay out of it. */
+static bool
+inode_page_cached (const struct inode *inode)
+{
+  return inode_data_tag (inode) == DISK_TAG_DATA;
+}
+#endif
+
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Lookups take
+   OPEN_INODES_LOCK for reading; adding or removing an inode
+   takes it for writing. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
+
+static struct inode *open_inodes_find (disk_sector_t);
 
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+}
+
+/* Returns the open inode for SECTOR, or a null pointer if there
+   is none.  OPEN_INODES_LOCK must be held. */
+static struct inode *
+open_inodes_find (disk_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector)
+        return inode;
+    }
+  return NULL;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -85,11 +185,17 @@ inode_create (disk_sector_t sector, off_t length, bool is_dir)
       disk_inode->is_dir = is_dir;
       disk_inode->parent = ROOT_DIR_SECTOR;
 
-      if(inode_indexed_allocate(disk_inode))
+      /* The data is left as one big hole, to be allocated as it
+         is written, except for the free map's: filling a hole in
+         the free map would mean writing the free map from within
+         a write to it. */
+      enum disk_tag old_tag = disk_set_tag (DISK_TAG_INODE);
+      if(sector != FREE_MAP_SECTOR || inode_allocate(disk_inode, length))
       {
         cache_write(sector, disk_inode);
         success = true;
       }
+      disk_set_tag (old_tag);
 
       // base filesystem //
       // if (free_map_allocate (sectors, &disk_inode->start))
@@ -121,25 +227,41 @@ inode_create (disk_sector_t sector, off_t length, bool is_dir)
 struct inode *
 inode_open (disk_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e))
+  rwlock_acquire_read (&open_inodes_lock);
+  inode = open_inodes_find (sector);
+  if (inode != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector)
-        {
-          inode_reopen (inode);
-          return inode;
-        }
+      inode_reopen (inode);
+      rwlock_release_read (&open_inodes_lock);
+      return inode;
+    }
+
+  /* Not open yet, so we need to add it.  If another thread is
+     already upgrading, fall back to a fresh write hold; either
+     way someone may have added it meanwhile, so look again. */
+  if (!rwlock_upgrade (&open_inodes_lock))
+    {
+      rwlock_release_read (&open_inodes_lock);
+      rwlock_acquire_write (&open_inodes_lock);
+    }
+  inode = open_inodes_find (sector);
+  if (inode != NULL)
+    {
+      inode_reopen (inode);
+      rwlock_release_write (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      rwlock_release_write (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -147,19 +269,34 @@ inode_open (disk_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  rwlock_init (&inode->dir_lock);
+  lock_init (&inode->delay_lock);
+  list_init (&inode->delayed);
+  inode->delay_cnt = 0;
+  inode->delay_reserved = 0;
+  inode->dirty = false;
   // disk_read (filesys_disk, inode->sector, &inode->data);
   // printf("inode_open(%d)\n", sector);
+  enum disk_tag old_tag = disk_set_tag (DISK_TAG_INODE);
   cache_read(inode->sector, &inode->data);
+  disk_set_tag (old_tag);
+  rwlock_release_write (&open_inodes_lock);
 
   return inode;
 }
 
-/* Reopens and returns INODE. */
+/* Reopens and returns INODE.
+   May be called with OPEN_INODES_LOCK held only for reading, so
+   the count is bumped atomically. */
 struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -170,33 +307,63 @@ inode_get_inumber (const struct inode *inode)
   return inode->sector;
 }
 
-/* Closes INODE and writes it to disk.
-   If this was the last reference to INODE, frees its memory.
-   If INODE was also a removed inode, frees its blocks. */
+/* Closes INODE.
+   If this was the last reference to INODE, writes it to disk,
+   allocating its delayed blocks, and frees its memory.
+   If INODE was also a removed inode, frees its blocks instead. */
 void
 inode_close (struct inode *inode)
 {
+  enum intr_level old_level;
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
-  /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  /* Release resources if this was the last opener.  The count
+     is dropped atomically against inode_reopen(), which doesn't
+     take OPEN_INODES_LOCK for writing. */
+  journal_begin ();
+  rwlock_acquire_write (&open_inodes_lock);
+  old_level = intr_disable ();
+  last = --inode->open_cnt == 0;
+  intr_set_level (old_level);
+  if (!last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      rwlock_release_write (&open_inodes_lock);
+      journal_end ();
+      return;
+    }
 
-      /* Deallocate blocks if removed. */
-      if (inode->removed)
-        {
-          free_map_release (inode->sector, 1);
-          // free_map_release (inode->data.start,
-          //                   bytes_to_sectors (inode->data.length));   //base filesystem
-          inode_free(inode);  //extended filesystem
-        }
+  /* Write the inode back before it leaves the list, so that a
+     concurrent inode_open() of the same sector can't read a stale
+     copy.  A removed inode's delayed blocks are just dropped. */
+  lock_acquire (&inode->delay_lock);
+  if (inode->removed)
+    inode_discard_delayed (inode);
+  else
+    inode_flush (inode);
+  lock_release (&inode->delay_lock);
 
-      free (inode);  //TODO: still need it? - ㅇㅇ
+  /* Remove from inode list and release lock. */
+  list_remove (&inode->elem);
+  rwlock_release_write (&open_inodes_lock);
+
+  /* Deallocate blocks if removed. */
+  if (inode->removed)
+    {
+#ifdef VM
+      frame_cache_forget (inode);
+#endif
+      free_map_release (inode->sector, 1);
+      // free_map_release (inode->data.start,
+      //                   bytes_to_sectors (inode->data.length));   //base filesystem
+      inode_free(inode);  //extended filesystem
     }
+  journal_end ();
+
+  free (inode);  //TODO: still need it? - ㅇㅇ
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -208,20 +375,25 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
-/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
-   Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
-off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
+/* Reads SIZE bytes from INODE into BUFFER, starting at position
+   OFFSET, through the buffer cache.  Returns the number of bytes
+   actually read, which may be less than SIZE if an error occurs
+   or end of file is reached. */
+static off_t
+inode_read_sectors (struct inode *inode, void *buffer_, off_t size,
+                    off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
+  enum disk_tag old_tag = disk_set_tag (inode_data_tag (inode));
 
   while (size > 0)
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      disk_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Disk sector to read, starting byte offset within sector.
+         The lookup holds DELAY_LOCK so that a hole can't be filled
+         in from a delayed block between it and the check below. */
+      disk_sector_t sector_idx;
       int sector_ofs = offset % DISK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -234,25 +406,43 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
+      lock_acquire (&inode->delay_lock);
+      sector_idx = byte_to_sector (inode, offset);
+      if (sector_idx == 0)
         {
-          /* Read full sector directly into caller's buffer. */
-          // disk_read (filesys_disk, sector_idx, buffer + bytes_read);
-          cache_read(sector_idx, buffer + bytes_read);
+          /* A hole reads as zeros, without touching the disk,
+             unless it has been written but not yet allocated. */
+          struct delayed_block *b
+            = delay_find (inode, offset / DISK_SECTOR_SIZE);
+          if (b != NULL)
+            memcpy (buffer + bytes_read, b->data + sector_ofs, chunk_size);
+          else
+            memset (buffer + bytes_read, 0, chunk_size);
+          lock_release (&inode->delay_lock);
         }
       else
         {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL)
+          lock_release (&inode->delay_lock);
+          if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
             {
-              bounce = malloc (DISK_SECTOR_SIZE);
+              /* Read full sector directly into caller's buffer. */
+              // disk_read (filesys_disk, sector_idx, buffer + bytes_read);
+              cache_read(sector_idx, buffer + bytes_read);
+            }
+          else
+            {
+              /* Read sector into bounce buffer, then partially copy
+                 into caller's buffer. */
               if (bounce == NULL)
-                break;
+                {
+                  bounce = malloc (DISK_SECTOR_SIZE);
+                  if (bounce == NULL)
+                    break;
+                }
+              // disk_read (filesys_disk, sector_idx, bounce);
+              cache_read(sector_idx, bounce);
+              memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
             }
-          // disk_read (filesys_disk, sector_idx, bounce);
-          cache_read(sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
         }
 
       /* Advance. */
@@ -261,59 +451,144 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       bytes_read += chunk_size;
     }
   free (bounce);
+  disk_set_tag (old_tag);
 
   return bytes_read;
 }
 
+/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
+   Returns the number of bytes actually read, which may be less
+   than SIZE if an error occurs or end of file is reached. */
+off_t
+inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
+{
+#ifdef VM
+  if (inode_page_cached (inode))
+    {
+      uint8_t *buffer = buffer_;
+      off_t bytes_read = 0;
+
+      /* Go a page at a time, copying from the page cache where
+         possible. */
+      while (size > 0)
+        {
+          off_t inode_left = inode_length (inode) - offset;
+          off_t page_left = PGSIZE - offset % PGSIZE;
+          off_t chunk_size = size < page_left ? size : page_left;
+          off_t chunk_read;
+
+          if (chunk_size > inode_left)
+            chunk_size = inode_left;
+          if (chunk_size <= 0)
+            break;
+          if (frame_cache_read (inode, buffer + bytes_read, chunk_size,
+                                offset))
+            chunk_read = chunk_size;
+          else
+            {
+              chunk_read = inode_read_sectors (inode, buffer + bytes_read,
+                                               chunk_size, offset);
+              if (chunk_read < chunk_size)
+                return bytes_read + chunk_read;
+            }
+          size -= chunk_read;
+          offset += chunk_read;
+          bytes_read += chunk_read;
+        }
+      return bytes_read;
+    }
+#endif
+  return inode_read_sectors (inode, buffer_, size, offset);
+}
+
+/* Reads LEN bytes at OFS, which must be page-aligned, from INODE
+   into the page at KPAGE, through the buffer cache, and zeroes the
+   rest of the page.  Returns true if all LEN bytes could be read.
+   For filling the page cache. */
+bool
+inode_read_page (struct inode *inode, void *kpage, off_t ofs, size_t len)
+{
+  ASSERT (ofs % PGSIZE == 0 && len <= PGSIZE);
+
+  if (inode_read_sectors (inode, kpage, len, ofs) != (off_t) len)
+    return false;
+  memset ((uint8_t *) kpage + len, 0, PGSIZE - len);
+  return true;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up or an error occurs.  A
+   write past end of file extends the inode; any gap left between
+   the old end and OFFSET becomes a hole.  Data sectors, and the
+   indirect blocks above them, are only allocated as they are
+   written.
+
+   In a plain file, a write to a hole, such as an append, doesn't
+   allocate at all: it goes into a delayed block, and the delayed
+   blocks get their sectors in one batch when the inode is
+   flushed, as does the new length.  Directories and the free map
+   are allocated, and their inodes written, right away. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset)
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
+#ifdef VM
+  off_t start = offset;
+#endif
   uint8_t *bounce = NULL;
+  bool delay = inode_data_tag (inode) == DISK_TAG_DATA;
+  bool inode_changed = false;
+  enum disk_tag old_tag;
 
   if (inode->deny_write_cnt)
     return 0;
 
-  //extensible filesystem
-  if(byte_to_sector(inode, offset + size - 1) == -1)
-  {
-    bool success;
-    success = inode_grow (& inode->data, offset + size);
-    if (!success){
-      return 0;
-    }
-
-    // write back the (extended) file size
-    inode->data.length = offset + size;
-    cache_write (inode->sector, & inode->data);
-  }
-
-//  printf("len %u | add %p\n",inode_length(inode),inode);    //debug
+  journal_begin ();
+  old_tag = disk_set_tag (inode_data_tag (inode));
+  lock_acquire (&inode->delay_lock);
   while (size > 0)
     {
-      /* Sector to write, starting byte offset within sector. */
-      disk_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Sector to write, allocated if it is a hole, and starting
+         byte offset within sector. */
+      struct sector_alloc alloc = {false, NULL, 0};
+      off_t index = offset / DISK_SECTOR_SIZE;
+      disk_sector_t sector_idx;
+      bool fresh;
       int sector_ofs = offset % DISK_SECTOR_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Bytes left in sector. */
       int sector_left = DISK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
 
       /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
+      int chunk_size = size < sector_left ? size : sector_left;
 
-      // printf("\n inode %p | buf %p | size %u | offs %u\n",inode, buffer_, size, offset);
-      // printf("len %u | sec ofs %u\n",inode_length(inode),sector_ofs);
-      // printf("chunk %d | min_left %d | inode_left %d | sector_left %d\n",chunk_size,min_left,inode_left,sector_left);
-      if (chunk_size <= 0)
+      disk_set_tag (DISK_TAG_INODE);
+      sector_idx = inode_index_to_sector (&inode->data, index, NULL);
+      fresh = sector_idx == 0;
+      if (fresh && delay)
+        {
+          struct delayed_block *b = delay_find (inode, index);
+          if (b == NULL)
+            b = delay_add (inode, index);
+          if (b != NULL)
+            {
+              memcpy (b->data + sector_ofs, buffer + bytes_written,
+                      chunk_size);
+              size -= chunk_size;
+              offset += chunk_size;
+              bytes_written += chunk_size;
+              continue;
+            }
+        }
+      if (fresh)
+        sector_idx = inode_index_to_sector (&inode->data, index, &alloc);
+      disk_set_tag (inode_data_tag (inode));
+      if (alloc.allocated)
+        inode_changed = true;
+      if (sector_idx == 0)
         break;
 
       if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE)
@@ -334,8 +609,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
           /* If the sector contains data before or after the chunk
              we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left)
+             first.  Otherwise, or if the sector was a hole until
+             now, we start with a sector of all zeros. */
+          if (!fresh && (sector_ofs > 0 || chunk_size < sector_left))
             // disk_read (filesys_disk, sector_idx, bounce);
             cache_read(sector_idx, bounce);
           else
@@ -352,6 +628,27 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     }
   free (bounce);
 
+  /* Write back the inode if a hole was filled in its direct
+     blocks, or if the file grew, unless that can wait for the
+     delayed blocks. */
+  if (offset > inode->data.length)
+    {
+      inode->data.length = offset;
+      if (delay)
+        inode->dirty = true;
+      else
+        inode_changed = true;
+    }
+  if (inode_changed)
+    inode_write_back (inode);
+  lock_release (&inode->delay_lock);
+  disk_set_tag (old_tag);
+  journal_end ();
+#ifdef VM
+  if (inode_page_cached (inode))
+    frame_cache_write (inode, buffer_, bytes_written, start);
+#endif
+
   return bytes_written;
 }
 
@@ -382,252 +679,384 @@ inode_length (const struct inode *inode)
   return inode->data.length;
 }
 
-/* Allocate memory to inode_disk. */
-bool
-inode_indexed_allocate(struct inode_disk *disk_inode)
+/* Allocates every data sector of the LENGTH bytes of the file
+   whose on-disk inode is DISK_INODE, and zeroes them, leaving no
+   holes.  Returns false if the disk is full. */
+static bool
+inode_allocate (struct inode_disk *disk_inode, off_t length)
 {
-  // struct inode inode;
-  // inode.direct_index = 0;
-  // inode.indirect_index = 0;
-  // inode.double_indirect_index = 0;
+  static char zeros[DISK_SECTOR_SIZE];
+  size_t i;
 
-  // inode_indexed_grow(&inode, disk_inode->length);
-  // disk_inode->direct_index = inode.direct_index;
-  // disk_inode->indirect_index = inode.indirect_index;
-  // disk_inode->double_indirect_index = inode.double_indirect_index;
+  for (i = 0; i < bytes_to_sectors (length); i++)
+    {
+      struct sector_alloc alloc = {false, NULL, 0};
+      disk_sector_t sector = inode_index_to_sector (disk_inode, i, &alloc);
+      if (sector == 0)
+        return false;
+      if (alloc.allocated)
+        cache_write (sector, zeros);
+    }
+  return true;
+}
 
-  // memcpy(&disk_inode->sectors, &inode.sectors, 14 * sizeof(disk_sector_t));
+/* Allocates a sector into *SECTORP for ALLOC, from its
+   reservation if it has one left.  Returns true if successful. */
+static bool
+alloc_sector (struct sector_alloc *alloc, disk_sector_t *sectorp)
+{
+  bool success;
 
-  return inode_grow(disk_inode, disk_inode->length);
+  if (alloc->reserve != NULL && *alloc->reserve > 0)
+    {
+      success = free_map_allocate_reserved (1, sectorp);
+      if (success)
+        --*alloc->reserve;
+    }
+  else
+    success = free_map_allocate (1, sectorp);
+  if (success)
+    {
+      alloc->allocated = true;
+      alloc_sector_cnt++;
+      alloc_call_cnt++;
+    }
+  return success;
 }
 
-
-bool
-inode_grow(struct inode_disk *disk_inode, off_t length)
+/* Fills in the hole at *SLOT with a data sector for ALLOC.
+   Returns false if the disk is full. */
+static bool
+alloc_data_sector (struct sector_alloc *alloc, disk_sector_t *slot)
 {
-  static char zeros[DISK_SECTOR_SIZE] = {0,}; //초기화를 잊지 말자! ㅠㅠ
+  if (alloc->data == 0)
+    return alloc_sector (alloc, slot);
+  *slot = alloc->data;
+  alloc->data = 0;
+  alloc->allocated = true;
+  return true;
+}
 
-  // printf("inode_disk(%d)\n", length); //debug
+/* Finds the data sector at INDEX below the indirect block at
+   *ENTRY, which has LEVEL levels of indirect blocks below it,
+   counting itself, like inode_index_to_sector(). */
+static disk_sector_t
+indirect_to_sector (disk_sector_t *entry, off_t index, int level,
+                    struct sector_alloc *alloc)
+{
+  disk_sector_t blocks[NUM_INDIRECT_SECTORS];
+  off_t unit = level == 1 ? 1 : NUM_INDIRECT_SECTORS;
+  disk_sector_t *slot = &blocks[index / unit];
+  disk_sector_t old, sector;
+  bool new_block = false;
 
-  if(length < 0) {
-    return false;
-  }
+  if (*entry == 0)
+    {
+      if (alloc == NULL || !alloc_sector (alloc, entry))
+        return 0;
+      memset (blocks, 0, sizeof blocks);
+      new_block = true;
+    }
+  else
+    cache_read (*entry, blocks);
 
-  size_t num_sectors = bytes_to_sectors(length); //써야하는 섹터 수 -> 써야하는 게 얼마나 더 남았는지 기록 -> 0 될 때까지 써랏
-  size_t len;
-  int i;
+  old = *slot;
+  if (level > 1)
+    sector = indirect_to_sector (slot, index % unit, level - 1, alloc);
+  else
+    {
+      if (*slot == 0 && alloc != NULL)
+        alloc_data_sector (alloc, slot);
+      sector = *slot;
+    }
+  if (new_block || *slot != old)
+    cache_write (*entry, blocks);
+  return sector;
+}
 
-  // (1) direct sectors
-  len = MIN(num_sectors, NUM_DIRECT_SECTORS);
-  for(i = 0; i < len; ++i)
-  {
-    if(disk_inode->direct_index[i] == 0) { // unoccupied
-      if(! free_map_allocate (1, &disk_inode->direct_index[i]))
-        return false;
-      cache_write (disk_inode->direct_index[i], zeros);
+/* Returns the sector that holds sector INDEX of the file whose
+   on-disk inode is IDISK, or 0 if that part of the file is a
+   hole, which reads as zeros.  Sector 0 holds the free map, so it
+   is never file data.
+
+   If ALLOC is non-null, fills a hole instead, with ALLOC's data
+   sector or a newly allocated one, allocating any missing
+   indirect blocks above it, and sets ALLOC's `allocated' if it
+   did anything, in which case IDISK may have changed.  Returns 0
+   only if the disk is full or INDEX is beyond the largest
+   file. */
+static disk_sector_t
+inode_index_to_sector (struct inode_disk *idisk, off_t index,
+                       struct sector_alloc *alloc)
+{
+  if (index < NUM_DIRECT_SECTORS)
+    {
+      disk_sector_t *slot = &idisk->direct_index[index];
+      if (*slot == 0 && alloc != NULL)
+        alloc_data_sector (alloc, slot);
+      return *slot;
     }
-  }
-  num_sectors -= len;
-  if(num_sectors == 0) {
-    return true;
-  }
+  index -= NUM_DIRECT_SECTORS;
 
-  // (2) indirect sector
-  len = MIN(num_sectors, NUM_INDIRECT_SECTORS);
-  if(! inode_grow_indirect (& disk_inode->indirect_index, len, 1))
-    return false;
-  num_sectors -= len;
-  if(num_sectors == 0) return true;
+  if (index < NUM_INDIRECT_SECTORS)
+    return indirect_to_sector (&idisk->indirect_index, index, 1, alloc);
+  index -= NUM_INDIRECT_SECTORS;
 
+  if (index < NUM_INDIRECT_SECTORS * NUM_INDIRECT_SECTORS)
+    return indirect_to_sector (&idisk->double_indirect_index, index, 2,
+                               alloc);
+  return 0;
+}
 
-  // (3) double indirect sector
-  len = MIN(num_sectors, NUM_INDIRECT_SECTORS * NUM_INDIRECT_SECTORS);
-  if(! inode_grow_indirect (& disk_inode->double_indirect_index, len, 2))
-    return false;
-  num_sectors -= len;
-  if(num_sectors == 0) return true;
+/* Returns the number of indirect blocks above sector INDEX of a
+   file: how many sectors, besides the data sector, filling a hole
+   there may take. */
+static size_t
+index_depth (off_t index)
+{
+  if (index < NUM_DIRECT_SECTORS)
+    return 0;
+  else if (index < NUM_DIRECT_SECTORS + NUM_INDIRECT_SECTORS)
+    return 1;
+  else
+    return 2;
+}
 
+/* Releases the indirect block ENTRY, which has LEVEL levels of
+   indirect blocks below it, counting itself, and everything
+   below it.  Holes are skipped. */
+static void
+inode_free_indirect (disk_sector_t entry, int level)
+{
+  disk_sector_t blocks[NUM_INDIRECT_SECTORS];
+  size_t i;
 
-  //if failed
-  return false;
+  if (entry == 0)
+    return;
+  cache_read (entry, blocks);
+  for (i = 0; i < NUM_INDIRECT_SECTORS; i++)
+    if (blocks[i] != 0)
+      {
+        if (level > 1)
+          inode_free_indirect (blocks[i], level - 1);
+        else
+          free_map_release (blocks[i], 1);
+      }
+  free_map_release (entry, 1);
 }
 
-/* for the indirect sectors, it operates recursively. */
-bool
-inode_grow_indirect(disk_sector_t* p_entry, size_t num_sectors, int level)
+/* Releases all of INODE's data sectors and indirect blocks. */
+static void
+inode_free (struct inode *inode)
 {
+  size_t i;
 
-  static char zeros[DISK_SECTOR_SIZE] = {0,}; //초기화를 잊지 말자! ㅠㅠ
+  for (i = 0; i < NUM_DIRECT_SECTORS; i++)
+    if (inode->data.direct_index[i] != 0)
+      free_map_release (inode->data.direct_index[i], 1);
+  inode_free_indirect (inode->data.indirect_index, 1);
+  inode_free_indirect (inode->data.double_indirect_index, 2);
+}
 
-  if (level == 0) {       // level 0 => allocate a single sector and put it into the block.
-    if (*p_entry == 0) {
-      if(! free_map_allocate (1, p_entry))
-        return false;
-      cache_write (*p_entry, zeros);
+/* Returns INODE's delayed block for sector INDEX, or a null
+   pointer if it has none.  DELAY_LOCK must be held. */
+static struct delayed_block *
+delay_find (struct inode *inode, off_t index)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&inode->delayed); e != list_end (&inode->delayed);
+       e = list_next (e))
+    {
+      struct delayed_block *b = list_entry (e, struct delayed_block, elem);
+      if (b->index >= index)
+        return b->index == index ? b : NULL;
     }
-    return true;
-  }
+  return NULL;
+}
 
-  disk_sector_t indirect_blocks[NUM_INDIRECT_SECTORS] = {0,};
-  if(*p_entry == 0) {
-    free_map_allocate (1, p_entry);
-    cache_write (*p_entry, zeros);      // fill with 0s.
-  }
-  cache_read(*p_entry, &indirect_blocks);
-  // printf("inode_grow_indirect %d %d %d\n", *p_entry, num_sectors, level); //debug
-
-  size_t unit = (level == 1 ? 1 : NUM_INDIRECT_SECTORS);
-  size_t len = DIV_ROUND_UP (num_sectors, unit);
-  int i;
-
-  for (i = 0; i < len; ++ i) {
-    size_t subsize = MIN(num_sectors, unit);
-    indirect_blocks[i] = 0;
-    if(! inode_grow_indirect (& indirect_blocks[i], subsize, level - 1)) //recursive
-      return false;
-    num_sectors -= subsize;
-  }
+/* Orders delayed blocks by index. */
+static bool
+delay_less (const struct list_elem *a_, const struct list_elem *b_,
+            void *aux UNUSED)
+{
+  const struct delayed_block *a = list_entry (a_, struct delayed_block,
+                                              elem);
+  const struct delayed_block *b = list_entry (b_, struct delayed_block,
+                                              elem);
+  return a->index < b->index;
+}
 
-  for(i = 0; i < len; ++i) {
-    // printf("indirect created(%d)\n", indirect_blocks[i]); //debug
-  }
+/* Adds a zeroed delayed block for the hole at sector INDEX of
+   INODE, reserving the sectors it will need, and returns it.
+   Flushes INODE first if it, or the file system as a whole, has
+   too many.  Returns a null pointer if the block should be
+   allocated right away instead.  DELAY_LOCK must be held. */
+static struct delayed_block *
+delay_add (struct inode *inode, off_t index)
+{
+  size_t need = 1 + index_depth (index);
+  struct delayed_block *b;
+  enum intr_level old_level;
 
-  ASSERT (num_sectors == 0);
-  cache_write (*p_entry, &indirect_blocks);
-  return true;
+  if (index >= NUM_DIRECT_SECTORS + NUM_INDIRECT_SECTORS
+               + NUM_INDIRECT_SECTORS * NUM_INDIRECT_SECTORS)
+    return NULL;
+  if (inode->delay_cnt >= DELAY_MAX || delay_total >= DELAY_TOTAL_MAX)
+    inode_flush (inode);
+  if (delay_total >= DELAY_TOTAL_MAX)
+    return NULL;
 
+  /* Flushing gives back whatever the blocks so far didn't use, so
+     try again after that if the disk looks full. */
+  if (!free_map_reserve (need))
+    {
+      inode_flush (inode);
+      if (!free_map_reserve (need))
+        return NULL;
+    }
+  b = malloc (sizeof *b);
+  if (b == NULL)
+    {
+      free_map_unreserve (need);
+      return NULL;
+    }
+  b->index = index;
+  memset (b->data, 0, sizeof b->data);
+  list_insert_ordered (&inode->delayed, &b->elem, delay_less, NULL);
+  inode->delay_cnt++;
+  inode->delay_reserved += need;
+
+  old_level = intr_disable ();
+  delay_total++;
+  intr_set_level (old_level);
+  return b;
 }
 
-
-/* Deallocate the inode. */
-void
-inode_free(struct inode *inode)
+/* Frees INODE's delayed blocks, along with their reservation.
+   DELAY_LOCK must be held. */
+static void
+delay_free_all (struct inode *inode)
 {
-  off_t file_length = inode->data.length;   //size in bytes
-  if(file_length < 0){
-     return false;
-  }
+  enum intr_level old_level;
+
+  while (!list_empty (&inode->delayed))
+    free (list_entry (list_pop_front (&inode->delayed),
+                      struct delayed_block, elem));
+  free_map_unreserve (inode->delay_reserved);
+  inode->delay_reserved = 0;
+
+  old_level = intr_disable ();
+  delay_total -= inode->delay_cnt;
+  intr_set_level (old_level);
+  inode->delay_cnt = 0;
+}
 
-  // (remaining) number of sectors, occupied by this file.
-  size_t num_sectors = bytes_to_sectors(file_length);
-  size_t i, len;
+/* Drops INODE's delayed blocks without writing them, for an inode
+   that is being deleted.  DELAY_LOCK must be held. */
+static void
+inode_discard_delayed (struct inode *inode)
+{
+  delay_free_all (inode);
+  inode->dirty = false;
+}
 
-  // (1) direct sectors
-  len = MIN(num_sectors, NUM_DIRECT_SECTORS);
-  for (i = 0; i < len; ++ i) {
-    free_map_release (inode->data.direct_index[i], 1);
-  }
-  num_sectors -= len;
+/* Writes INODE's in-memory copy to its sector.  DELAY_LOCK must
+   be held. */
+static void
+inode_write_back (struct inode *inode)
+{
+  enum disk_tag old_tag = disk_set_tag (DISK_TAG_INODE);
+  cache_write (inode->sector, &inode->data);
+  disk_set_tag (old_tag);
+  inode->dirty = false;
+  inode_write_cnt++;
+}
 
+/* Allocates sectors for all of INODE's delayed blocks and writes
+   them, then writes back INODE itself if it has changed.  The
+   data sectors are allocated as one run if the free map has one,
+   in index order, so an appended file stays contiguous; the
+   indirect blocks come from the reservation afterward.
+   DELAY_LOCK must be held. */
+static void
+inode_flush (struct inode *inode)
+{
+  enum disk_tag old_tag;
+  disk_sector_t first = 0;
+  struct list_elem *e;
+  size_t i;
 
-  // (2) indirect block sector
-  len = MIN(num_sectors, NUM_INDIRECT_SECTORS);
-  if(len > 0) {
-    inode_free_indirect (inode->data.indirect_index, len, 1);
-    num_sectors -= len;
-  }
+  ASSERT (lock_held_by_current_thread (&inode->delay_lock));
 
-  // (3) doubly indirect sector
-  len = MIN(num_sectors, NUM_INDIRECT_SECTORS * NUM_INDIRECT_SECTORS);
-  if(len > 0) {
-    inode_free_indirect (inode->data.double_indirect_index, len, 2);
-    num_sectors -= len;
-  }
+  if (inode->delay_cnt > 0)
+    {
+      old_tag = disk_set_tag (DISK_TAG_INODE);
+      if (free_map_allocate_reserved (inode->delay_cnt, &first))
+        {
+          inode->delay_reserved -= inode->delay_cnt;
+          alloc_sector_cnt += inode->delay_cnt;
+          alloc_call_cnt++;
+        }
 
-  ASSERT (num_sectors == 0);
-  return true;
+      i = 0;
+      for (e = list_begin (&inode->delayed); e != list_end (&inode->delayed);
+           e = list_next (e))
+        {
+          struct delayed_block *b = list_entry (e, struct delayed_block,
+                                                elem);
+          struct sector_alloc alloc = {false, &inode->delay_reserved, 0};
+          disk_sector_t sector;
+
+          if (first != 0)
+            alloc.data = first + i++;
+          disk_set_tag (DISK_TAG_INODE);
+          sector = inode_index_to_sector (&inode->data, b->index, &alloc);
+          if (alloc.data != 0)
+            free_map_release (alloc.data, 1);
+          ASSERT (sector != 0);
+
+          disk_set_tag (DISK_TAG_DATA);
+          cache_write (sector, b->data);
+        }
+      disk_set_tag (old_tag);
 
+      delay_block_cnt += inode->delay_cnt;
+      delay_batch_cnt++;
+      delay_free_all (inode);
+      inode->dirty = true;
+    }
+  if (inode->dirty)
+    inode_write_back (inode);
 }
 
-/* for the indirect sectors, it operates recursively. */
+/* Flushes every open inode's delayed blocks and length to the
+   buffer cache. */
 void
-inode_free_indirect(disk_sector_t entry, size_t num_sectors, int level)
+inode_flush_all (void)
 {
-  ASSERT (level <= 2);
-
-  if (level == 0) {
-    free_map_release (entry, 1);
-    return;
-  }
-
-  disk_sector_t indirect_blocks[NUM_INDIRECT_SECTORS] = {-1,};
-  cache_read(entry, &indirect_blocks);
-
-  size_t unit = (level == 1 ? 1 : NUM_INDIRECT_SECTORS);
-  size_t i, len = DIV_ROUND_UP (num_sectors, unit);
-
-  for (i = 0; i < len; ++ i) {
-    size_t subsize = MIN(num_sectors, unit);
-    inode_free_indirect (indirect_blocks[i], subsize, level - 1);
-    num_sectors -= subsize;
-  }
-
-  ASSERT (num_sectors == 0);
-  free_map_release (entry, 1);
-
+  struct list_elem *e;
 
+  rwlock_acquire_read (&open_inodes_lock);
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      journal_begin ();
+      lock_acquire (&inode->delay_lock);
+      inode_flush (inode);
+      lock_release (&inode->delay_lock);
+      journal_end ();
+    }
+  rwlock_release_read (&open_inodes_lock);
 }
 
-
-/* Helper function for byte_to_sector() */
-disk_sector_t
-inode_index_to_sector(const struct inode_disk *idisk, off_t index)
-{
-  off_t index_base = 0, index_limit = 0;   // base, limit for sector index
-  disk_sector_t ret;
-  int i;
-
-  // (1) direct blocks
-  // printf("direct\n"); //debug
-  index_limit += NUM_DIRECT_SECTORS;
-  if (index < index_limit) {
-    // printf(" **** index: %d, limit: %d, ret: %d \n", index, index_limit, idisk->direct_index[index]); //debug
-    return idisk->direct_index[index];
-  }
-
-  // else: need more space after direct blocks -> indirect blocks.
-  index_base = index_limit;
-  // (2) single indirect block
-  index_limit += NUM_INDIRECT_SECTORS;
-  if (index < index_limit) {
-    // printf(" **** single indirect\n"); //debug
-    struct inode_indirect_block_sector *indirect_idisk;
-    disk_sector_t indirect_blocks[NUM_INDIRECT_SECTORS] = {-1, };
-    disk_sector_t *ibp = &indirect_blocks;
-
-    ibp= calloc(1, sizeof(disk_sector_t) * NUM_INDIRECT_SECTORS);
-    cache_read(idisk->indirect_index, indirect_blocks);
-    // printf("--- cache.. indirect index: %d\n", idisk->indirect_index); //debug
-
-    ret = indirect_blocks[index - index_base];
-    free(ibp);
-    // printf(" **** ret: %d, index: %d, base: %d \n", ret, index, index_base); //debug
-
-    return ret;
-  }
-
-  //else: need more space -> doubly indirect block
-  index_base = index_limit;
-  // (3) doubly indirect block
-  index_limit +=  NUM_INDIRECT_SECTORS * NUM_INDIRECT_SECTORS;
-  if (index < index_limit) {
-    // printf(" **** double-indirect\n"); //debug
-    off_t index_first = (index - index_base) / NUM_INDIRECT_SECTORS;
-    off_t index_second = (index - index_base) % NUM_INDIRECT_SECTORS;
-
-    disk_sector_t indirect_blocks[NUM_INDIRECT_SECTORS];
-    disk_sector_t *ibp = &indirect_blocks;
-    ibp= calloc(1, sizeof(disk_sector_t) * NUM_INDIRECT_SECTORS);
-
-    cache_read(idisk->double_indirect_index, ibp);
-    cache_read(indirect_blocks[index_first], ibp);
-    ret = indirect_blocks[index_second];
-
-    free(ibp);
-    return ret;
-  }
-
-  // if failed -  if INODE does not contain data for a byte at offset POS.
-  return -1;
-
+/* Prints inode write-back and allocation statistics. */
+void
+inode_print_stats (void)
+{
+  printf ("Inodes: %lld inode writes, %lld sectors allocated in %lld "
+          "free-map updates (%lld delayed, in %lld batches)\n",
+          inode_write_cnt, alloc_sector_cnt, alloc_call_cnt,
+          delay_block_cnt, delay_batch_cnt);
 }
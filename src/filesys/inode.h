@@ -3,6 +3,7 @@
 #include <list.h>
 #include "filesys/off_t.h"
 #include "devices/disk.h"
+#include "threads/synch.h"
 
 #ifndef FILESYS_INODE_H
 #define FILESYS_INODE_H
@@ -16,7 +17,10 @@
 #define NUM_INDIRECT_SECTORS 128 //(8+8)*8
 
 /* On-disk inode.
-   Must be exactly DISK_SECTOR_SIZE = 512 bytes long. */
+   Must be exactly DISK_SECTOR_SIZE = 512 bytes long.
+   A zero sector number, in the inode or in an indirect block,
+   marks a hole, which reads as zeros and is allocated when it is
+   first written. */
 struct inode_disk
   {
     // disk_sector_t start;             /* First data sector. */ //no use for now
@@ -40,7 +44,19 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    struct rwlock dir_lock;             /* Directory entries, if a dir. */
     struct inode_disk data;             /* Inode content. */
+
+    /* Delayed allocation.  Writes to holes in a plain file land in
+       `delayed' and only get disk sectors when the inode is
+       flushed, all at once. */
+    struct lock delay_lock;             /* Guards the members below and
+                                           the sector pointers in DATA. */
+    struct list delayed;                /* Delayed blocks, by index. */
+    size_t delay_cnt;                   /* Number of delayed blocks. */
+    size_t delay_reserved;              /* Free-map sectors reserved for
+                                           the delayed blocks. */
+    bool dirty;                         /* DATA differs from disk? */
   };
 
 
@@ -55,18 +71,12 @@ disk_sector_t inode_get_inumber (const struct inode *);
 void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
+bool inode_read_page (struct inode *, void *kpage, off_t ofs, size_t len);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
-
-// void inode_indexed_allocate(struct inode_disk *disk_inode);
-// bool inode_grow(struct inode_disk *disk_inode, off_t length);
-bool inode_grow_indirect(disk_sector_t* p_entry, size_t num_sectors, int level);
-
-void inode_free(struct inode *inode);
-void inode_free_indirect(disk_sector_t entry, size_t num_sectors, int level);
-
-// disk_sector_t inode_index_to_sector(const struct inode_disk *idisk, off_t index);
+void inode_flush_all (void);
+void inode_print_stats (void);
 
 #endif /* filesys/inode.h */
@@ -0,0 +1,360 @@
+#include "filesys/journal.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <hash.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Write-ahead journal for file system metadata.
+
+   Inodes, index blocks, directories and the free map are written
+   through the buffer cache as before, but the cache keeps each
+   such sector out of write-back until the transaction that
+   changed it is committed, that is, written to the log here: one
+   disk write of a descriptor followed by images of all the
+   sectors the transaction changed.  A transaction takes in every
+   operation that ended since the last commit (group commit), so
+   a burst of creates costs one log write rather than a
+   synchronous write per sector.  An operation bracketed by
+   journal_begin() and journal_end() lands in a single
+   transaction, unless the sectors it changes don't fit in the
+   cache alongside everyone else's, in which case the cache
+   commits early.
+
+   At boot, journal_init() copies the images of every complete
+   transaction in the log to their home sectors, in order, which
+   redoes whatever was committed but not yet written back when
+   the machine went down.  The first transaction whose descriptor
+   or checksum doesn't match was torn by the crash, or is left
+   over from before, and ends the log.
+
+   Once everything the log covers has been written back, the log
+   starts over from the beginning: a checkpoint.  The header holds
+   the sequence number of the first transaction to replay, so
+   older transactions still lying in the log are ignored.
+
+   File data is not journaled, except in sectors that were logged
+   as metadata since the last checkpoint: replay would otherwise
+   put back the old metadata over the new data. */
+
+#define HEADER_MAGIC 0x4a524e4c         /* "JRNL". */
+#define DESC_MAGIC 0x54584e44           /* "TXND". */
+
+/* On-disk journal header, in JOURNAL_SECTOR. */
+struct journal_header
+  {
+    unsigned magic;                     /* HEADER_MAGIC. */
+    uint32_t seq;                       /* First transaction to replay. */
+    uint32_t unused[126];               /* Not used. */
+  };
+
+/* On-disk transaction descriptor, the first sector of a
+   transaction in the log.  Images of the CNT sectors follow it. */
+#define DESC_SECTOR_CNT 124
+struct journal_desc
+  {
+    unsigned magic;                     /* DESC_MAGIC. */
+    uint32_t seq;                       /* Sequence number. */
+    uint32_t cnt;                       /* Number of sectors logged. */
+    uint32_t checksum;                  /* Of the descriptor, with this
+                                           member 0, and the images. */
+    disk_sector_t sectors[DESC_SECTOR_CNT]; /* Home of each image. */
+  };
+
+/* Pages for a whole transaction, descriptor included. */
+#define TXN_PAGES DIV_ROUND_UP ((JOURNAL_TXN_MAX + 1) * DISK_SECTOR_SIZE, \
+                                PGSIZE)
+
+/* The log, protected by the buffer cache's lock, since only
+   filesys/cache.c writes to it after journal_init(). */
+static bool journal_active;     /* Logging metadata yet? */
+static size_t log_pos;          /* Next free sector of the log. */
+static uint32_t next_seq;       /* Sequence number of next transaction. */
+static struct bitmap *logged;   /* Sectors logged since last checkpoint. */
+
+/* Operations, protected by JOURNAL_LOCK. */
+static struct lock journal_lock;
+static struct condition commit_done;    /* Signaled when a commit ends. */
+static int active_ops;                  /* Operations in progress. */
+static bool commit_running;             /* Writing the log? */
+static bool commit_wanted;              /* Commit when operations end? */
+
+/* Statistics. */
+static long long op_cnt;                /* Operations ended. */
+static long long txn_cnt;               /* Transactions committed... */
+static long long forced_cnt;            /* ...of which before operations
+                                           ended. */
+static long long logged_cnt;            /* Sectors logged. */
+static long long checkpoint_cnt;        /* Checkpoints. */
+
+static void replay (void);
+static void write_header (void);
+
+/* Initializes the journal, setting up an empty one in its region
+   of the disk if FORMAT is true, and otherwise replaying what the
+   log on disk holds.  Must be called before anything else writes
+   to the file system. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof (struct journal_header) == DISK_SECTOR_SIZE);
+  ASSERT (sizeof (struct journal_desc) == DISK_SECTOR_SIZE);
+  ASSERT (JOURNAL_TXN_MAX <= DESC_SECTOR_CNT);
+
+  lock_init (&journal_lock);
+  cond_init (&commit_done);
+  logged = bitmap_create (disk_size (filesys_disk));
+  if (logged == NULL)
+    PANIC ("journal bitmap creation failed--disk is too large");
+
+  if (format)
+    next_seq = 1;
+  else
+    replay ();
+  log_pos = 0;
+  write_header ();
+  journal_active = true;
+}
+
+/* Returns the disk sector of sector POS of the log. */
+static disk_sector_t
+log_sector (size_t pos)
+{
+  return JOURNAL_SECTOR + 1 + pos;
+}
+
+/* Redoes every complete transaction in the log, from the one the
+   header names onward, and sets NEXT_SEQ past the last. */
+static void
+replay (void)
+{
+  uint8_t *buf = palloc_get_multiple (PAL_ASSERT, TXN_PAGES);
+  struct journal_header *h = (struct journal_header *) buf;
+  struct journal_desc *d = (struct journal_desc *) buf;
+  enum disk_tag old_tag = disk_set_tag (DISK_TAG_JOURNAL);
+  size_t pos = 0;
+  size_t txns = 0, sectors = 0;
+
+  disk_read (filesys_disk, JOURNAL_SECTOR, buf);
+  if (h->magic != HEADER_MAGIC)
+    PANIC ("file system has no journal (format it with -f)");
+  next_seq = h->seq;
+
+  while (pos < JOURNAL_LOG_CNT)
+    {
+      uint32_t checksum;
+      size_t i;
+
+      disk_read (filesys_disk, log_sector (pos), buf);
+      if (d->magic != DESC_MAGIC || d->seq != next_seq
+          || d->cnt == 0 || d->cnt > JOURNAL_TXN_MAX
+          || d->cnt > JOURNAL_LOG_CNT - pos - 1)
+        break;
+      disk_read_multiple (filesys_disk, log_sector (pos + 1), d->cnt,
+                          buf + DISK_SECTOR_SIZE);
+      checksum = d->checksum;
+      d->checksum = 0;
+      if (hash_bytes (buf, (d->cnt + 1) * DISK_SECTOR_SIZE) != checksum)
+        break;
+      for (i = 0; i < d->cnt; i++)
+        if (d->sectors[i] >= disk_size (filesys_disk))
+          break;
+      if (i < d->cnt)
+        break;
+
+      for (i = 0; i < d->cnt; i++)
+        disk_write (filesys_disk, d->sectors[i],
+                    buf + (i + 1) * DISK_SECTOR_SIZE);
+      txns++;
+      sectors += d->cnt;
+      pos += d->cnt + 1;
+      next_seq++;
+    }
+  disk_set_tag (old_tag);
+  palloc_free_multiple (buf, TXN_PAGES);
+
+  if (txns > 0)
+    printf ("Journal: replayed %zu transactions, %zu sectors.\n",
+            txns, sectors);
+}
+
+/* Writes the journal header, which starts the log over at
+   NEXT_SEQ. */
+static void
+write_header (void)
+{
+  static struct journal_header h;
+  enum disk_tag old_tag = disk_set_tag (DISK_TAG_JOURNAL);
+
+  h.magic = HEADER_MAGIC;
+  h.seq = next_seq;
+  disk_write (filesys_disk, JOURNAL_SECTOR, &h);
+  disk_set_tag (old_tag);
+}
+
+/* Starts a commit if one is wanted and no operation is in
+   progress, in which case the caller must call run_commit().
+   JOURNAL_LOCK must be held. */
+static bool
+start_commit (void)
+{
+  if (!commit_wanted || active_ops > 0 || commit_running)
+    return false;
+  commit_wanted = false;
+  commit_running = true;
+  return true;
+}
+
+/* Commits the running transaction and lets operations start
+   again. */
+static void
+run_commit (void)
+{
+  cache_commit ();
+
+  lock_acquire (&journal_lock);
+  commit_running = false;
+  cond_broadcast (&commit_done, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Starts an operation: everything it writes goes into the same
+   transaction.  Operations nest; only the outermost counts.
+   Waits while a commit is being written, but never for another
+   operation, so it is safe to call with other locks held. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->journal_depth++ > 0)
+    return;
+  lock_acquire (&journal_lock);
+  while (commit_running)
+    cond_wait (&commit_done, &journal_lock);
+  active_ops++;
+  lock_release (&journal_lock);
+}
+
+/* Ends an operation started by journal_begin().  If it was the
+   last one in progress, and a commit is wanted or the running
+   transaction is half full, commits it. */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+  bool commit;
+
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0)
+    return;
+  lock_acquire (&journal_lock);
+  op_cnt++;
+  active_ops--;
+  if (cache_pinned_cnt () >= JOURNAL_TXN_MAX / 2)
+    commit_wanted = true;
+  commit = start_commit ();
+  lock_release (&journal_lock);
+  if (commit)
+    run_commit ();
+}
+
+/* Commits the running transaction now, or, if operations are in
+   progress, as soon as the last of them ends. */
+void
+journal_commit (void)
+{
+  bool commit;
+
+  lock_acquire (&journal_lock);
+  commit_wanted = true;
+  commit = start_commit ();
+  lock_release (&journal_lock);
+  if (commit)
+    run_commit ();
+}
+
+/* Returns true if a write to SECTOR, attributed to the running
+   thread's disk tag, must be logged before it is written back. */
+bool
+journal_wants (disk_sector_t sector)
+{
+  enum disk_tag tag = disk_get_tag ();
+
+  if (!journal_active)
+    return false;
+  return (tag == DISK_TAG_INODE || tag == DISK_TAG_DIR
+          || tag == DISK_TAG_FREE_MAP || bitmap_test (logged, sector));
+}
+
+/* Returns true if the log has room for a transaction of CNT
+   sectors. */
+bool
+journal_has_room (size_t cnt)
+{
+  return log_pos + cnt + 1 <= JOURNAL_LOG_CNT;
+}
+
+/* Logs a transaction of the CNT sectors in SECTORS[], whose
+   contents are in BUFFER after room for the descriptor, all in
+   one disk write, and returns once it is on disk.  FORCED says
+   whether operations were still in progress. */
+void
+journal_write (size_t cnt, const disk_sector_t sectors[], void *buffer,
+               bool forced)
+{
+  struct journal_desc *d = buffer;
+  enum disk_tag old_tag;
+  size_t i;
+
+  ASSERT (cnt > 0 && cnt <= JOURNAL_TXN_MAX);
+  ASSERT (journal_has_room (cnt));
+
+  memset (d, 0, sizeof *d);
+  d->magic = DESC_MAGIC;
+  d->seq = next_seq++;
+  d->cnt = cnt;
+  for (i = 0; i < cnt; i++)
+    {
+      d->sectors[i] = sectors[i];
+      bitmap_mark (logged, sectors[i]);
+    }
+  d->checksum = hash_bytes (buffer, (cnt + 1) * DISK_SECTOR_SIZE);
+
+  old_tag = disk_set_tag (DISK_TAG_JOURNAL);
+  disk_write_multiple (filesys_disk, log_sector (log_pos), cnt + 1, buffer);
+  disk_set_tag (old_tag);
+  log_pos += cnt + 1;
+
+  txn_cnt++;
+  logged_cnt += cnt;
+  if (forced)
+    forced_cnt++;
+}
+
+/* Empties the log, once every sector logged in it has been
+   written back. */
+void
+journal_checkpoint (void)
+{
+  log_pos = 0;
+  write_header ();
+  bitmap_set_all (logged, false);
+  checkpoint_cnt++;
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  printf ("Journal: %lld operations in %lld transactions (%lld forced), "
+          "%lld sectors logged, %lld checkpoints\n",
+          op_cnt, txn_cnt, forced_cnt, logged_cnt, checkpoint_cnt);
+}
@@ -0,0 +1,32 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+
+/* Most sectors a single transaction may log: half the buffer
+   cache, since the sectors of the running transaction stay in
+   it until they are committed. */
+#define JOURNAL_TXN_MAX 32
+
+/* The journal: a header sector, then the log itself, in the
+   sectors right after the root directory's inode. */
+#define JOURNAL_SECTOR 2
+#define JOURNAL_LOG_CNT (3 * (JOURNAL_TXN_MAX + 1))
+#define JOURNAL_SECTOR_CNT (1 + JOURNAL_LOG_CNT)
+
+void journal_init (bool format);
+void journal_begin (void);
+void journal_end (void);
+void journal_commit (void);
+void journal_print_stats (void);
+
+/* For filesys/cache.c, which must hold its lock. */
+bool journal_wants (disk_sector_t);
+bool journal_has_room (size_t cnt);
+void journal_write (size_t cnt, const disk_sector_t sectors[],
+                    void *buffer, bool forced);
+void journal_checkpoint (void);
+
+#endif /* filesys/journal.h */
@@ -0,0 +1,62 @@
+#ifndef __LIB_DISKSTAT_H
+#define __LIB_DISKSTAT_H
+
+/* Disk statistics, as reported by the diskstat() system call,
+   and the disk I/O trace, as reported by disktrace().  Shared
+   between the kernel and user programs, so only plain C types
+   appear here. */
+
+/* Number of ATA channels. */
+#define DISKSTAT_CHANNEL_CNT 2
+
+/* What a disk request was for, as far as the disk driver can
+   tell from the thread that submitted it. */
+enum disk_tag
+  {
+    DISK_TAG_OTHER,             /* Not attributed. */
+    DISK_TAG_DATA,              /* File data missing from the cache. */
+    DISK_TAG_DIR,               /* Directory contents missing from it. */
+    DISK_TAG_INODE,             /* Inode or index block missing from it. */
+    DISK_TAG_FREE_MAP,          /* Free map missing from it. */
+    DISK_TAG_WRITEBACK,         /* Periodic cache write-back. */
+    DISK_TAG_EVICT,             /* Dirty cache entry evicted. */
+    DISK_TAG_SWAP,              /* Paging to or from swap. */
+    DISK_TAG_JOURNAL,           /* File system journal. */
+    DISK_TAG_CNT                /* Number of tags. */
+  };
+
+/* Number of latency histogram buckets.  Bucket I counts requests
+   that took between 2**I and 2**(I+1) - 1 CPU cycles from
+   submission to completion. */
+#define DISK_HIST_CNT 32
+
+/* Times are in timer ticks unless noted. */
+struct diskstat
+  {
+    long long uptime;                   /* Ticks since boot. */
+    long long busy_ticks[DISKSTAT_CHANNEL_CNT];
+                                        /* Ticks each channel had
+                                           requests to carry out. */
+    long long overlap_ticks;            /* Ticks all were busy at once. */
+    long long read_cnt[DISKSTAT_CHANNEL_CNT];  /* Sectors read. */
+    long long write_cnt[DISKSTAT_CHANNEL_CNT]; /* Sectors written. */
+    long long tag_cnt[DISK_TAG_CNT];    /* Requests, by tag. */
+    long long hist[2][DISK_HIST_CNT];   /* Latency of reads ([0]) and
+                                           writes ([1]), in cycles. */
+  };
+
+/* One completed request in the disk I/O trace. */
+struct disktrace
+  {
+    long long tick;                     /* When submitted. */
+    unsigned sector;                    /* First sector. */
+    unsigned short cnt;                 /* Number of sectors. */
+    unsigned char disk;                 /* Channel * 2 + device. */
+    unsigned char write;                /* 1 if a write, 0 if a read. */
+    int tag;                            /* enum disk_tag value. */
+    unsigned latency;                   /* Cycles from submission to
+                                           completion, at most
+                                           UINT_MAX. */
+  };
+
+#endif /* lib/diskstat.h */
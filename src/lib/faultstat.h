@@ -0,0 +1,32 @@
+#ifndef __LIB_FAULTSTAT_H
+#define __LIB_FAULTSTAT_H
+
+/* Page fault statistics, as reported by the faultstat() system
+   call.  Shared between the kernel and user programs, so only
+   plain C types appear here. */
+
+/* How a page fault was resolved. */
+enum fault_type
+  {
+    FAULT_FILE,                 /* Page read from a file. */
+    FAULT_SWAP,                 /* Page read from swap. */
+    FAULT_ZERO,                 /* Zero-filled or zero page mapped. */
+    FAULT_COW,                  /* Copy-on-write page copied. */
+    FAULT_STACK,                /* Stack grown. */
+    FAULT_INVALID,              /* Bad access. */
+    FAULT_TYPE_CNT              /* Number of fault types. */
+  };
+
+/* Number of latency histogram buckets.  Bucket I counts faults
+   that took between 2**I and 2**(I+1) - 1 CPU cycles to handle. */
+#define FAULT_HIST_CNT 32
+
+struct faultstat
+  {
+    unsigned long long total[FAULT_TYPE_CNT];   /* All processes. */
+    unsigned long long process[FAULT_TYPE_CNT]; /* Calling process. */
+    unsigned long long hist[FAULT_TYPE_CNT][FAULT_HIST_CNT];
+                                                /* Latency, all processes. */
+  };
+
+#endif /* lib/faultstat.h */
@@ -0,0 +1,21 @@
+#ifndef __LIB_MEMSTAT_H
+#define __LIB_MEMSTAT_H
+
+/* Page allocator usage, as reported by the memstat() system
+   call.  Shared between the kernel and user programs. */
+struct memstat
+  {
+    unsigned kernel_used;       /* Pages in use in the kernel pool. */
+    unsigned kernel_total;      /* Pages in the kernel pool. */
+    unsigned user_used;         /* Pages in use in the user pool. */
+    unsigned user_total;        /* Pages in the user pool. */
+    unsigned zero_page_hits;    /* Caller's page faults served by the
+                                   shared zero page. */
+    unsigned cache_pages;       /* Pages in the page cache. */
+    unsigned cache_mapped;      /* Page faults that mapped a cached
+                                   page instead of copying it. */
+    unsigned cache_read_bytes;  /* Bytes read() copied from the page
+                                   cache. */
+  };
+
+#endif /* lib/memstat.h */
@@ -0,0 +1,45 @@
+#ifndef __LIB_PROCSTAT_H
+#define __LIB_PROCSTAT_H
+
+/* Per-thread scheduling and CPU accounting, as reported by the
+   procstat() system call.  Shared between the kernel and user
+   programs, so only plain C types appear here. */
+
+/* A thread's scheduling state.  The kernel's enum thread_status
+   takes its values from these. */
+enum procstat_status
+  {
+    PROCSTAT_RUNNING,           /* Running. */
+    PROCSTAT_READY,             /* Ready to run. */
+    PROCSTAT_BLOCKED,           /* Waiting, for wait_reason. */
+    PROCSTAT_DYING,             /* About to be destroyed. */
+    PROCSTAT_STATUS_CNT         /* Number of states. */
+  };
+
+/* Why a thread is (or was) blocked. */
+enum wait_reason
+  {
+    WAIT_OTHER,                 /* thread_block() called directly. */
+    WAIT_SEMA,                  /* Semaphore down. */
+    WAIT_LOCK,                  /* Lock acquire. */
+    WAIT_DISK,                  /* Disk command completion. */
+    WAIT_SLEEP,                 /* timer_sleep(). */
+    WAIT_REASON_CNT             /* Number of wait reasons. */
+  };
+
+/* Accounting snapshot of a single thread.
+   All times are in timer ticks. */
+struct procstat
+  {
+    int tid;                            /* Thread identifier. */
+    char name[16];                      /* Thread name. */
+    int status;                         /* enum procstat_status value. */
+    int wait_reason;                    /* Current enum wait_reason. */
+    long long run_ticks;                /* Ticks spent running. */
+    long long ready_ticks;              /* Ticks spent on ready queue. */
+    long long blocked_ticks[WAIT_REASON_CNT]; /* Ticks blocked, by reason. */
+    unsigned voluntary_switches;        /* Blocked or yielded. */
+    unsigned involuntary_switches;      /* Preempted at end of slice. */
+  };
+
+#endif /* lib/procstat.h */
@@ -28,7 +28,21 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Monitoring. */
+    SYS_PROCSTAT,               /* Per-thread scheduling statistics. */
+    SYS_MEMSTAT,                /* Page allocator usage. */
+
+    /* Process creation. */
+    SYS_FORK,                   /* Clone this process. */
+
+    /* More monitoring.  New calls go last, so that existing
+       numbers don't change. */
+    SYS_FAULTSTAT,              /* Page fault statistics. */
+    SYS_WSSSTAT,                /* Working-set estimates. */
+    SYS_DISKSTAT,               /* Disk channel utilization. */
+    SYS_DISKTRACE               /* Disk I/O trace. */
   };
 
 #endif /* lib/syscall-nr.h */
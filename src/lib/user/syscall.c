@@ -182,3 +182,45 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+procstat (struct procstat *stats, int max)
+{
+  return syscall2 (SYS_PROCSTAT, stats, max);
+}
+
+bool
+memstat (struct memstat *stats)
+{
+  return syscall1 (SYS_MEMSTAT, stats);
+}
+
+bool
+faultstat (struct faultstat *stats)
+{
+  return syscall1 (SYS_FAULTSTAT, stats);
+}
+
+int
+wssstat (struct wssstat *stats, int max)
+{
+  return syscall2 (SYS_WSSSTAT, stats, max);
+}
+
+bool
+diskstat (struct diskstat *stats)
+{
+  return syscall1 (SYS_DISKSTAT, stats);
+}
+
+int
+disktrace (struct disktrace *trace, int max)
+{
+  return syscall2 (SYS_DISKTRACE, trace, max);
+}
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
@@ -3,6 +3,11 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <diskstat.h>
+#include <faultstat.h>
+#include <memstat.h>
+#include <procstat.h>
+#include <wssstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +50,15 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Monitoring. */
+int procstat (struct procstat *, int max);
+bool memstat (struct memstat *);
+bool faultstat (struct faultstat *);
+int wssstat (struct wssstat *, int max);
+bool diskstat (struct diskstat *);
+int disktrace (struct disktrace *, int max);
+
+/* Process creation. */
+pid_t fork (void);
+
 #endif /* lib/user/syscall.h */
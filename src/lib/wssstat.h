@@ -0,0 +1,14 @@
+#ifndef __LIB_WSSSTAT_H
+#define __LIB_WSSSTAT_H
+
+/* Per-process working-set estimates, as reported by the wssstat()
+   system call.  Shared between the kernel and user programs. */
+struct wssstat
+  {
+    int tid;                    /* Thread identifier. */
+    char name[16];              /* Thread name. */
+    unsigned wss;               /* Pages used in the last few scans. */
+    unsigned rss;               /* Pages resident. */
+  };
+
+#endif /* lib/wssstat.h */
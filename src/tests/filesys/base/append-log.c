@@ -0,0 +1,105 @@
+/* Appends many small records of varying sizes to a log file, the
+   way a program writing a log does, until the file reaches into
+   its indirect blocks.  Reports the sectors written meanwhile,
+   which with delayed allocation should come to little more than
+   the log's own data.  Checks the log's contents while it is
+   still open, when much of it has no sectors yet, and again
+   after closing and reopening it. */
+
+#include <diskstat.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LOG_SIZE (80 * 1024)    /* Past the 48 kB of direct blocks. */
+#define RECORD_MAX 200
+
+static char record[RECORD_MAX];
+static char buf[RECORD_MAX];
+
+/* Returns the sectors written to all disks in DS. */
+static long long
+sectors_written (const struct diskstat *ds)
+{
+  long long sum = 0;
+  int i;
+
+  for (i = 0; i < DISKSTAT_CHANNEL_CNT; i++)
+    sum += ds->write_cnt[i];
+  return sum;
+}
+
+/* Returns the size of the record starting at byte OFS of the
+   log. */
+static int
+record_size (int ofs)
+{
+  return 1 + (ofs * 7 + ofs / 13) % RECORD_MAX;
+}
+
+/* Returns the expected value of byte OFS of the log. */
+static char
+log_byte (int ofs)
+{
+  return ofs % 251;
+}
+
+/* Reads back the whole log from FD and checks it. */
+static void
+check_log (int fd, const char *when)
+{
+  int ofs, i;
+
+  seek (fd, 0);
+  for (ofs = 0; ofs < LOG_SIZE; )
+    {
+      int size = record_size (ofs);
+      if (size > LOG_SIZE - ofs)
+        size = LOG_SIZE - ofs;
+      if (read (fd, buf, size) != size)
+        fail ("short read at offset %d %s", ofs, when);
+      for (i = 0; i < size; i++)
+        if (buf[i] != log_byte (ofs + i))
+          fail ("bad byte at offset %d %s", ofs + i, when);
+      ofs += size;
+    }
+  msg ("log verified %s", when);
+}
+
+void
+test_main (void)
+{
+  struct diskstat before, after;
+  int fd, ofs, records, i;
+
+  CHECK (create ("log", 0), "create \"log\"");
+  CHECK ((fd = open ("log")) > 1, "open \"log\"");
+
+  CHECK (diskstat (&before), "diskstat");
+  records = 0;
+  for (ofs = 0; ofs < LOG_SIZE; )
+    {
+      int size = record_size (ofs);
+      if (size > LOG_SIZE - ofs)
+        size = LOG_SIZE - ofs;
+      for (i = 0; i < size; i++)
+        record[i] = log_byte (ofs + i);
+      if (write (fd, record, size) != size)
+        fail ("write of %d bytes at offset %d failed", size, ofs);
+      ofs += size;
+      records++;
+    }
+  CHECK (filesize (fd) == LOG_SIZE, "filesize is %d", LOG_SIZE);
+  check_log (fd, "while open");
+  close (fd);
+
+  CHECK (diskstat (&after), "diskstat");
+  msg ("appended %d records: %lld sectors written for %d data sectors",
+       records, sectors_written (&after) - sectors_written (&before),
+       LOG_SIZE / 512);
+
+  CHECK ((fd = open ("log")) > 1, "reopen \"log\"");
+  CHECK (filesize (fd) == LOG_SIZE, "filesize is %d", LOG_SIZE);
+  check_log (fd, "after reopen");
+  close (fd);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# The sector count depends on the cache and the allocator.
+s/: \d+ sectors written for/: N sectors written for/ foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(append-log) begin
+(append-log) create "log"
+(append-log) open "log"
+(append-log) diskstat
+(append-log) filesize is 81920
+(append-log) log verified while open
+(append-log) diskstat
+(append-log) appended 1116 records: N sectors written for 160 data sectors
+(append-log) reopen "log"
+(append-log) filesize is 81920
+(append-log) log verified after reopen
+(append-log) end
+EOF
+pass;
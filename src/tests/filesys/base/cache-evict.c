@@ -0,0 +1,88 @@
+/* Writes more than the buffer cache holds, so that dirty entries
+   are evicted and written back in runs, and then interleaves
+   reads that miss, and so read ahead, with writes to a second
+   file that keep dirty entries coming up for eviction while the
+   sectors read ahead are being stored.  Checks every sector of
+   both files. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 160          /* Well over the cache's 64 sectors. */
+
+static char buf[SECTOR_SIZE];
+
+/* Fills BUF with the contents expected in sector SECTOR of the
+   file whose name starts with NAME[0]. */
+static void
+fill (const char *name, int sector)
+{
+  memset (buf, name[0] + sector * 7, sizeof buf);
+  buf[0] = sector;
+}
+
+/* Checks that BUF holds sector SECTOR of NAME. */
+static void
+check (const char *name, int sector)
+{
+  static char actual[SECTOR_SIZE];
+
+  memcpy (actual, buf, sizeof buf);
+  fill (name, sector);
+  compare_bytes (actual, buf, sizeof buf, sector * SECTOR_SIZE, name);
+}
+
+/* Reads back all of file NAME and checks it. */
+static void
+check_file_sectors (const char *name)
+{
+  int fd, i;
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\" for verification", name);
+  for (i = 0; i < SECTOR_CNT; i++)
+    {
+      if (read (fd, buf, sizeof buf) != SECTOR_SIZE)
+        fail ("read sector %d of \"%s\" failed", i, name);
+      check (name, i);
+    }
+  msg ("verified contents of \"%s\"", name);
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  int a, b, i;
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK ((a = open ("a")) > 1, "open \"a\"");
+  for (i = 0; i < SECTOR_CNT; i++)
+    {
+      fill ("a", i);
+      if (write (a, buf, sizeof buf) != SECTOR_SIZE)
+        fail ("write sector %d of \"a\" failed", i);
+    }
+  msg ("wrote %d sectors to \"a\"", SECTOR_CNT);
+  close (a);
+  check_file_sectors ("a");
+
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((a = open ("a")) > 1, "open \"a\"");
+  CHECK ((b = open ("b")) > 1, "open \"b\"");
+  for (i = 0; i < SECTOR_CNT; i++)
+    {
+      fill ("b", i);
+      if (write (b, buf, sizeof buf) != SECTOR_SIZE)
+        fail ("write sector %d of \"b\" failed", i);
+      if (read (a, buf, sizeof buf) != SECTOR_SIZE)
+        fail ("read sector %d of \"a\" failed", i);
+      check ("a", i);
+    }
+  msg ("wrote \"b\" while reading \"a\"");
+  close (a);
+  close (b);
+  check_file_sectors ("b");
+}
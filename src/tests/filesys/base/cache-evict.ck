@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-evict) begin
+(cache-evict) create "a"
+(cache-evict) open "a"
+(cache-evict) wrote 160 sectors to "a"
+(cache-evict) open "a" for verification
+(cache-evict) verified contents of "a"
+(cache-evict) create "b"
+(cache-evict) open "a"
+(cache-evict) open "b"
+(cache-evict) wrote "b" while reading "a"
+(cache-evict) open "b" for verification
+(cache-evict) verified contents of "b"
+(cache-evict) end
+EOF
+pass;
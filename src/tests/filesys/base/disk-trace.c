@@ -0,0 +1,67 @@
+/* Exercises the disk I/O trace.  Writes a file too big for the
+   buffer cache, so that dirty entries are evicted, and reads it
+   back, so that reads miss.  Then fetches the trace with
+   disktrace() and the per-tag totals with diskstat(), reports
+   what each tag accounts for, and checks that the trace saw the
+   file's data being read and that its entries look sane. */
+
+#include <diskstat.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (96 * 1024)
+#define BLOCK_SIZE 4096
+#define TRACE_MAX 256
+
+static char buf[BLOCK_SIZE];
+static struct disktrace trace[TRACE_MAX];
+
+static const char *tag_names[DISK_TAG_CNT] =
+  {"other", "data", "dir", "inode", "free-map", "writeback", "evict", "swap",
+   "journal"};
+
+void
+test_main (void)
+{
+  struct diskstat ds;
+  int data_reads = 0;
+  int fd, cnt, i;
+  size_t ofs;
+
+  CHECK (create ("traced", 0), "create \"traced\"");
+  CHECK ((fd = open ("traced")) > 1, "open \"traced\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    {
+      memset (buf, ofs / BLOCK_SIZE, BLOCK_SIZE);
+      if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %zu bytes at offset %zu failed", BLOCK_SIZE, ofs);
+    }
+  seek (fd, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+      fail ("read %zu bytes at offset %zu failed", BLOCK_SIZE, ofs);
+  close (fd);
+
+  cnt = disktrace (trace, TRACE_MAX);
+  CHECK (cnt > 0, "disktrace");
+  CHECK (diskstat (&ds), "diskstat");
+  for (i = 0; i < cnt; i++)
+    {
+      struct disktrace *t = &trace[i];
+
+      if (t->tag < 0 || t->tag >= DISK_TAG_CNT)
+        fail ("trace entry %d has bad tag %d", i, t->tag);
+      if (t->cnt == 0 || t->disk >= 2 * DISKSTAT_CHANNEL_CNT)
+        fail ("trace entry %d is malformed", i);
+      if (t->tag == DISK_TAG_DATA && !t->write)
+        data_reads++;
+    }
+  if (data_reads == 0)
+    fail ("no data reads among the last %d requests", cnt);
+
+  for (i = 0; i < DISK_TAG_CNT; i++)
+    if (ds.tag_cnt[i] != 0)
+      msg ("%s: %lld requests", tag_names[i], ds.tag_cnt[i]);
+}
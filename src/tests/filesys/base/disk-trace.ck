@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Which tags show up, and how often, depends on the cache, so the
+# per-tag lines are only checked for form and for the file's data
+# having gone to disk at all.
+my ($tags) = qr/other|data|dir|inode|free-map|writeback|evict|swap|journal/;
+fail "no requests tagged \"data\"\n"
+  if !grep (/^\(disk-trace\) data: [1-9]\d* requests$/, @output);
+@output = grep (!/^\(disk-trace\) (?:$tags): [1-9]\d* requests$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(disk-trace) begin
+(disk-trace) create "traced"
+(disk-trace) open "traced"
+(disk-trace) disktrace
+(disk-trace) diskstat
+(disk-trace) end
+EOF
+pass;
@@ -0,0 +1,67 @@
+/* Measures what the metadata journal costs.  Runs a workload of
+   small creates, writes and removes, which is mostly metadata
+   updates, and reports the ticks it took, the sectors written to
+   disk meanwhile, and how many of the disk requests were journal
+   writes rather than write-back.  Compare with the journal's
+   statistics printed at shutdown for how well operations were
+   grouped into transactions. */
+
+#include <diskstat.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 64             /* Files created and removed. */
+#define FILE_SIZE 512           /* Bytes written to each. */
+
+static char buf[FILE_SIZE];
+
+/* Returns the sectors written to all disks so far, per DS. */
+static long long
+sectors_written (const struct diskstat *ds)
+{
+  long long cnt = 0;
+  int i;
+
+  for (i = 0; i < DISKSTAT_CHANNEL_CNT; i++)
+    cnt += ds->write_cnt[i];
+  return cnt;
+}
+
+void
+test_main (void)
+{
+  struct diskstat start, end;
+  char name[16];
+  int fd, i;
+
+  memset (buf, 'j', sizeof buf);
+  CHECK (diskstat (&start), "diskstat");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "j%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (write (fd, buf, sizeof buf) != FILE_SIZE)
+        fail ("write \"%s\" failed", name);
+      close (fd);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "j%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+  CHECK (diskstat (&end), "diskstat");
+
+  msg ("%d files created, written and removed in %lld ticks",
+       FILE_CNT, end.uptime - start.uptime);
+  msg ("%lld sectors written", sectors_written (&end) - sectors_written (&start));
+  msg ("journal: %lld requests, write-back: %lld requests",
+       end.tag_cnt[DISK_TAG_JOURNAL] - start.tag_cnt[DISK_TAG_JOURNAL],
+       end.tag_cnt[DISK_TAG_WRITEBACK] - start.tag_cnt[DISK_TAG_WRITEBACK]);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings and request counts vary from run to run.
+s/removed in \d+ ticks$/removed in N ticks/ foreach @output;
+s/\) \d+ sectors written$/) N sectors written/ foreach @output;
+s/journal: \d+ requests, write-back: \d+ requests$/journal: N requests, write-back: N requests/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(journal-bench) begin
+(journal-bench) diskstat
+(journal-bench) diskstat
+(journal-bench) 64 files created, written and removed in N ticks
+(journal-bench) N sectors written
+(journal-bench) journal: N requests, write-back: N requests
+(journal-bench) end
+EOF
+pass;
@@ -0,0 +1,75 @@
+/* Measures sequential read throughput.  Writes a file too big for
+   the buffer cache, then reads it back front to back a few times,
+   reporting the kB/s achieved and the ticks the CPU spent idle
+   while the reads ran.  Compare runs with and without the -nodma
+   kernel option to see what DMA buys. */
+
+#include <procstat.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (256 * 1024)
+#define BLOCK_SIZE 4096
+#define PASS_CNT 4
+
+static char buf[BLOCK_SIZE];
+static struct procstat stats[64];
+
+/* Returns the ticks the idle thread has spent running. */
+static long long
+idle_ticks (void)
+{
+  int cnt = procstat (stats, sizeof stats / sizeof *stats);
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    if (!strcmp (stats[i].name, "idle"))
+      return stats[i].run_ticks;
+  fail ("no procstat entry for the idle thread");
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "bench";
+  int fd, pass;
+  size_t ofs;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    {
+      memset (buf, ofs / BLOCK_SIZE, BLOCK_SIZE);
+      if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %zu bytes at offset %zu failed", BLOCK_SIZE, ofs);
+    }
+  msg ("wrote %d kB", FILE_SIZE / 1024);
+  close (fd);
+
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      long long start = uptime ();
+      long long idle = idle_ticks ();
+      long long ticks;
+
+      fd = open (file_name);
+      if (fd < 2)
+        fail ("open \"%s\" failed", file_name);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        {
+          if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+            fail ("read %zu bytes at offset %zu failed", BLOCK_SIZE, ofs);
+          if (buf[0] != (char) (ofs / BLOCK_SIZE))
+            fail ("wrong data at offset %zu", ofs);
+        }
+      close (fd);
+
+      ticks = uptime () - start;
+      idle = idle_ticks () - idle;
+      msg ("pass %d: %d kB in %lld ticks (%lld kB/s), %lld ticks idle",
+           pass + 1, FILE_SIZE / 1024, ticks,
+           ticks > 0 ? FILE_SIZE / 1024 * TIMER_FREQ / ticks : 0, idle);
+    }
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings vary from run to run.
+s/kB in \d+ ticks \(\d+ kB\/s\), \d+ ticks idle$/kB in N ticks (N kB\/s), N ticks idle/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(seq-read-bench) begin
+(seq-read-bench) create "bench"
+(seq-read-bench) open "bench"
+(seq-read-bench) wrote 256 kB
+(seq-read-bench) pass 1: 256 kB in N ticks (N kB/s), N ticks idle
+(seq-read-bench) pass 2: 256 kB in N ticks (N kB/s), N ticks idle
+(seq-read-bench) pass 3: 256 kB in N ticks (N kB/s), N ticks idle
+(seq-read-bench) pass 4: 256 kB in N ticks (N kB/s), N ticks idle
+(seq-read-bench) end
+EOF
+pass;
@@ -0,0 +1,91 @@
+/* Measures creating large files, which are left as holes until
+   written.  Creates a 1 MB file and reports how long it took and
+   how many sectors went to disk meanwhile, then writes a single
+   byte 1 MB into an empty file and reports the same.  Reads
+   both files back, checking that the holes read as zeros, and
+   reports the sectors read. */
+
+#include <diskstat.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+#define BLOCK_SIZE 4096
+
+static char buf[BLOCK_SIZE];
+
+/* Returns the sectors written to or read from all disks in DS. */
+static long long
+sectors (const struct diskstat *ds, bool write)
+{
+  const long long *cnt = write ? ds->write_cnt : ds->read_cnt;
+  long long sum = 0;
+  int i;
+
+  for (i = 0; i < DISKSTAT_CHANNEL_CNT; i++)
+    sum += cnt[i];
+  return sum;
+}
+
+/* Reports the ticks and sectors written since BEFORE for WHAT. */
+static void
+report (const char *what, const struct diskstat *before)
+{
+  struct diskstat after;
+
+  CHECK (diskstat (&after), "diskstat");
+  msg ("%s: %lld ticks, %lld sectors written", what,
+       after.uptime - before->uptime,
+       sectors (&after, true) - sectors (before, true));
+}
+
+/* Reads NAME, which must be FILE_SIZE bytes long, checking that it
+   is all zeros except for a 1 in the last byte if LAST_ONE. */
+static void
+check_zeros (const char *name, bool last_one)
+{
+  struct diskstat before, after;
+  int fd, ofs, i;
+
+  CHECK (diskstat (&before), "diskstat");
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    {
+      if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("short read of \"%s\" at offset %d", name, ofs);
+      for (i = 0; i < BLOCK_SIZE; i++)
+        {
+          char expect = last_one && ofs + i == FILE_SIZE - 1;
+          if (buf[i] != expect)
+            fail ("bad byte at offset %d in \"%s\"", ofs + i, name);
+        }
+    }
+  close (fd);
+  CHECK (diskstat (&after), "diskstat");
+  msg ("read \"%s\": %lld sectors read", name,
+       sectors (&after, false) - sectors (&before, false));
+}
+
+void
+test_main (void)
+{
+  struct diskstat before;
+  char one = 1;
+  int fd;
+
+  CHECK (diskstat (&before), "diskstat");
+  CHECK (create ("big", FILE_SIZE), "create \"big\"");
+  report ("create 1 MB", &before);
+
+  CHECK (create ("sparse", 0), "create \"sparse\"");
+  CHECK ((fd = open ("sparse")) > 1, "open \"sparse\"");
+  CHECK (diskstat (&before), "diskstat");
+  seek (fd, FILE_SIZE - 1);
+  CHECK (write (fd, &one, 1) == 1, "write 1 byte at 1 MB");
+  report ("write 1 byte at 1 MB", &before);
+  close (fd);
+
+  check_zeros ("big", false);
+  check_zeros ("sparse", true);
+}
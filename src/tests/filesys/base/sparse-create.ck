@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings and sector counts vary from run to run.
+s/: \d+ ticks, \d+ sectors written$/: N ticks, N sectors written/
+  foreach @output;
+s/: \d+ sectors read$/: N sectors read/ foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(sparse-create) begin
+(sparse-create) diskstat
+(sparse-create) create "big"
+(sparse-create) diskstat
+(sparse-create) create 1 MB: N ticks, N sectors written
+(sparse-create) create "sparse"
+(sparse-create) open "sparse"
+(sparse-create) diskstat
+(sparse-create) write 1 byte at 1 MB
+(sparse-create) diskstat
+(sparse-create) write 1 byte at 1 MB: N ticks, N sectors written
+(sparse-create) diskstat
+(sparse-create) open "big"
+(sparse-create) diskstat
+(sparse-create) read "big": N sectors read
+(sparse-create) diskstat
+(sparse-create) open "sparse"
+(sparse-create) diskstat
+(sparse-create) read "sparse": N sectors read
+(sparse-create) end
+EOF
+pass;
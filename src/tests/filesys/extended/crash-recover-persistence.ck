@@ -0,0 +1,54 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test, @prereq_tests);
+
+# The crash can come at any point, so rather than one expected
+# archive, accept any prefix of the sequence the test creates:
+# d0, d0/f0 ... d0/f9, d1, and so on.  Every file must hold all
+# 1024 bytes written to it, except that the last one created may
+# still be empty.  File contents are not checked, since only
+# metadata is journaled.
+my (@output) = read_text_file ("$test.output");
+common_checks ("file system extraction run", @output);
+@output = get_core_output ("file system extraction run", @output);
+@output = grep (!/^[a-zA-Z0-9-_]+: exit\(\d+\)$/, @output);
+fail join ("\n", "Error extracting file system:", @output) if @output;
+
+my (%actual) = read_tar ("$prereq_tests[0].tar");
+fail "tar is missing from the file system\n" if !exists $actual{'tar'};
+fail "crash-recover is missing from the file system\n"
+  if !exists $actual{'crash-recover'};
+delete @actual{'tar', 'crash-recover'};
+
+my (@sequence);
+for my $d (0...9) {
+    push (@sequence, "d$d");
+    push (@sequence, "d$d/f$_") foreach 0...9;
+}
+
+my ($cnt) = 0;
+$cnt++ while $cnt < @sequence && exists $actual{$sequence[$cnt]};
+foreach my $name (sort keys %actual) {
+    my ($pos) = grep ($sequence[$_] eq $name, 0...$#sequence);
+    fail "$name exists in the file system but should not\n"
+      if !defined $pos;
+    fail "$name survived the crash but $sequence[$cnt], "
+      . "created before it, did not\n"
+      if $pos > $cnt;
+}
+for my $i (0...$cnt - 1) {
+    my ($name) = $sequence[$i];
+    if ($name !~ m%/%) {
+	fail "$name should be a directory\n" if !is_dir ($actual{$name});
+    } else {
+	fail "$name should be an ordinary file\n" if is_dir ($actual{$name});
+	my ($size) = file_size ($actual{$name});
+	my ($last) = $i == $cnt - 1;
+	fail "$name is $size bytes long but should be 1024"
+	  . ($last ? " or 0" : "") . "\n"
+	  if $size != 1024 && !($last && $size == 0);
+    }
+}
+pass;
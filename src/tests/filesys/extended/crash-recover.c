@@ -0,0 +1,46 @@
+/* Creates directories full of 1 kB files, one after another,
+   until the kernel simulates a crash partway through (see the
+   "-o crash-after" option in Make.tests).  The persistence check
+   then verifies that the file system came back consistent: what
+   survived is exactly the first directories and files created,
+   every file but the last written in full. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DIR_CNT 10              /* Directories to create. */
+#define FILE_CNT 10             /* Files in each directory. */
+#define FILE_SIZE 1024          /* Bytes in each file. */
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int i, j;
+
+  memset (buf, 'x', sizeof buf);
+  for (i = 0; i < DIR_CNT; i++)
+    {
+      char name[32];
+
+      snprintf (name, sizeof name, "d%d", i);
+      CHECK (mkdir (name), "mkdir \"%s\"", name);
+      quiet = true;
+      for (j = 0; j < FILE_CNT; j++)
+        {
+          int fd;
+
+          snprintf (name, sizeof name, "d%d/f%d", i, j);
+          CHECK (create (name, 0), "create \"%s\"", name);
+          CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+          CHECK (write (fd, buf, sizeof buf) == FILE_SIZE,
+                 "write \"%s\"", name);
+          close (fd);
+        }
+      quiet = false;
+    }
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+fail "Run didn't start the test\n"
+  if !grep (/^\(crash-recover\) begin$/, @output);
+fail "Run finished without crashing\n"
+  if grep (/^\(crash-recover\) end$/, @output);
+fail "Run didn't crash: no \"Crashing\" message\n"
+  if !grep (/^Crashing: wrote \d+ of \d+ sectors/, @output);
+pass;
@@ -76,6 +76,18 @@ shuffle (void *buf_, size_t cnt, size_t size)
     }
 }
 
+/* Returns the number of timer ticks since boot, which the kernel
+   reports along with its disk statistics. */
+int
+uptime (void)
+{
+  struct diskstat ds;
+
+  if (!diskstat (&ds))
+    fail ("diskstat failed");
+  return ds.uptime;
+}
+
 void
 exec_children (const char *child_name, pid_t pids[], size_t child_cnt) 
 {
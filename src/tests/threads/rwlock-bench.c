@@ -0,0 +1,216 @@
+/* Microbenchmark for the reader-writer lock.
+
+   Runs a group of threads over a shared table, each operation
+   being a read (scan the table) or a write (update it) in a
+   fixed ratio, once with the table guarded by a reader-writer
+   lock and once by a plain lock, and reports the ticks each
+   took.  Every critical section yields the CPU partway through,
+   so readers that may share the lock really do overlap.  Along
+   the way, checks that a writer never overlaps anyone else and
+   exercises the try, upgrade and downgrade operations. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 8            /* Number of worker threads. */
+#define OP_CNT 200              /* Operations per worker. */
+#define TABLE_SIZE 16           /* Entries in the shared table. */
+
+static struct rwlock rwlock;
+static struct lock plain_lock;
+static struct semaphore done;
+
+static int table[TABLE_SIZE];
+static int active_readers;
+static int active_writers;
+static int max_readers;
+
+/* Per-run parameters. */
+static int write_pct;           /* Percentage of operations that write. */
+static bool use_rwlock;         /* Reader-writer or plain lock? */
+
+static thread_func bench_thread;
+static void run_ratio (int pct);
+static void test_try_upgrade_downgrade (void);
+
+void
+test_rwlock_bench (void)
+{
+  static const int ratios[] = {0, 10, 50, 90};
+  size_t i;
+
+  rwlock_init (&rwlock);
+  lock_init (&plain_lock);
+  sema_init (&done, 0);
+
+  test_try_upgrade_downgrade ();
+  for (i = 0; i < sizeof ratios / sizeof *ratios; i++)
+    run_ratio (ratios[i]);
+  pass ();
+}
+
+/* Checks the non-blocking operations from a single thread. */
+static void
+test_try_upgrade_downgrade (void)
+{
+  if (!rwlock_try_acquire_read (&rwlock))
+    fail ("try_acquire_read failed on a free lock");
+  if (!rwlock_try_acquire_read (&rwlock))
+    fail ("second try_acquire_read failed");
+  if (rwlock_try_acquire_write (&rwlock))
+    fail ("try_acquire_write succeeded with readers");
+  rwlock_release_read (&rwlock);
+
+  if (!rwlock_upgrade (&rwlock))
+    fail ("upgrade failed with no other upgrader");
+  if (!rwlock_held_for_write (&rwlock))
+    fail ("upgrade did not yield a write hold");
+  if (rwlock_try_acquire_read (&rwlock))
+    fail ("try_acquire_read succeeded under a writer");
+
+  rwlock_downgrade (&rwlock);
+  if (rwlock_held_for_write (&rwlock))
+    fail ("downgrade kept the write hold");
+  if (!rwlock_try_acquire_read (&rwlock))
+    fail ("try_acquire_read failed after downgrade");
+  rwlock_release_read (&rwlock);
+  rwlock_release_read (&rwlock);
+
+  if (!rwlock_try_acquire_write (&rwlock))
+    fail ("try_acquire_write failed on a free lock");
+  rwlock_release_write (&rwlock);
+  msg ("try/upgrade/downgrade ok");
+}
+
+/* Runs the workload at WRITE_PCT percent writes under both kinds
+   of lock and reports the elapsed ticks. */
+static void
+run_ratio (int pct)
+{
+  int64_t ticks[2];
+  int run;
+
+  write_pct = pct;
+  for (run = 0; run < 2; run++)
+    {
+      int64_t start;
+      int i;
+
+      use_rwlock = run == 0;
+      max_readers = 0;
+      start = timer_ticks ();
+      for (i = 0; i < THREAD_CNT; i++)
+        {
+          char name[16];
+          snprintf (name, sizeof name, "bench %d", i);
+          thread_create (name, PRI_DEFAULT, bench_thread, (void *) i);
+        }
+      for (i = 0; i < THREAD_CNT; i++)
+        sema_down (&done);
+      ticks[run] = timer_elapsed (start);
+    }
+
+  msg ("%3d%% writes: rwlock %lld ticks (up to %d readers), "
+       "lock %lld ticks",
+       write_pct, ticks[0], max_readers, ticks[1]);
+}
+
+static void
+begin_read (void)
+{
+  if (use_rwlock)
+    rwlock_acquire_read (&rwlock);
+  else
+    lock_acquire (&plain_lock);
+
+  enum intr_level old_level = intr_disable ();
+  if (active_writers != 0)
+    fail ("reader entered while a writer was active");
+  if (++active_readers > max_readers)
+    max_readers = active_readers;
+  intr_set_level (old_level);
+}
+
+static void
+end_read (void)
+{
+  enum intr_level old_level = intr_disable ();
+  active_readers--;
+  intr_set_level (old_level);
+
+  if (use_rwlock)
+    rwlock_release_read (&rwlock);
+  else
+    lock_release (&plain_lock);
+}
+
+static void
+begin_write (void)
+{
+  if (use_rwlock)
+    rwlock_acquire_write (&rwlock);
+  else
+    lock_acquire (&plain_lock);
+
+  enum intr_level old_level = intr_disable ();
+  if (active_readers != 0 || active_writers != 0)
+    fail ("writer entered while the lock was in use");
+  active_writers++;
+  intr_set_level (old_level);
+}
+
+static void
+end_write (void)
+{
+  enum intr_level old_level = intr_disable ();
+  active_writers--;
+  intr_set_level (old_level);
+
+  if (use_rwlock)
+    rwlock_release_write (&rwlock);
+  else
+    lock_release (&plain_lock);
+}
+
+static void
+bench_thread (void *id_)
+{
+  int id = (int) id_;
+  int i;
+
+  for (i = 0; i < OP_CNT; i++)
+    {
+      /* Spread the writes evenly over the operations, with each
+         thread at a different phase. */
+      bool write = ((i + id * 7) * write_pct) % 100 < write_pct;
+      int j;
+
+      if (write)
+        {
+          begin_write ();
+          table[0]++;
+          thread_yield ();
+          for (j = 1; j < TABLE_SIZE; j++)
+            table[j] = table[0];
+          end_write ();
+        }
+      else
+        {
+          int first;
+
+          begin_read ();
+          first = table[0];
+          thread_yield ();
+          for (j = 1; j < TABLE_SIZE; j++)
+            if (table[j] != first)
+              fail ("reader saw a torn update");
+          end_read ();
+        }
+    }
+  sema_up (&done);
+}
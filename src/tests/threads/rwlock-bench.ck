@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings vary from run to run.
+s/rwlock \d+ ticks \(up to \d+ readers\), lock \d+ ticks$/rwlock N ticks (up to N readers), lock N ticks/
+  foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(rwlock-bench) begin
+(rwlock-bench) try/upgrade/downgrade ok
+(rwlock-bench)   0% writes: rwlock N ticks (up to N readers), lock N ticks
+(rwlock-bench)  10% writes: rwlock N ticks (up to N readers), lock N ticks
+(rwlock-bench)  50% writes: rwlock N ticks (up to N readers), lock N ticks
+(rwlock-bench)  90% writes: rwlock N ticks (up to N readers), lock N ticks
+(rwlock-bench) PASS
+(rwlock-bench) end
+EOF
+pass;
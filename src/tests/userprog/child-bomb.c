@@ -0,0 +1,31 @@
+/* Child process run by exec-stress test.
+
+   Given a depth as its first command-line argument, spawns two
+   copies of itself one level shallower.  It waits for the first
+   but never for the second, so every level leaves an orphan
+   behind that its parent never reaps. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-bomb";
+
+int
+main (int argc, char *argv[])
+{
+  int depth;
+
+  if (argc != 2)
+    fail ("bad command-line arguments");
+  depth = atoi (argv[1]);
+  if (depth > 0)
+    {
+      char cmd_line[32];
+      snprintf (cmd_line, sizeof cmd_line, "child-bomb %d", depth - 1);
+      wait (exec (cmd_line));
+      exec (cmd_line);
+    }
+  return depth;
+}
@@ -0,0 +1,33 @@
+/* Measures process spawn latency: executes and waits for a
+   trivial child many times in a row and reports the elapsed
+   timer ticks and the resulting spawns per second. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SPAWN_CNT 64            /* Number of exec + wait rounds. */
+
+void
+test_main (void)
+{
+  long long start, elapsed;
+  int i;
+
+  start = uptime ();
+  for (i = 0; i < SPAWN_CNT; i++)
+    {
+      pid_t pid = exec ("child-simple");
+      if (pid == PID_ERROR)
+        fail ("exec #%d failed", i);
+      if (wait (pid) != 81)
+        fail ("wait for child #%d returned wrong status", i);
+    }
+  elapsed = uptime () - start;
+
+  msg ("%d spawns in %lld ticks", SPAWN_CNT, elapsed);
+  if (elapsed > 0)
+    msg ("%lld spawns per second", SPAWN_CNT * TIMER_FREQ / elapsed);
+  else
+    msg ("more than %d spawns per second", SPAWN_CNT * TIMER_FREQ);
+}
@@ -0,0 +1,82 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings vary from run to run.
+s/64 spawns in \d+ ticks/64 spawns in N ticks/ foreach @output;
+s/^\(exec-bench\) (\d+|more than \d+) spawns per second$/(exec-bench) N spawns per second/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(exec-bench) begin
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(child-simple) run
+(exec-bench) 64 spawns in N ticks
+(exec-bench) N spawns per second
+(exec-bench) end
+EOF
+pass;
@@ -0,0 +1,70 @@
+/* Fork-bomb style stress test for process exit and wait.
+
+   Each round spawns a tree of child-bomb processes in which half
+   of the children are never waited for, waits until they have
+   all exited, and samples the kernel page pool.  A process must
+   release its kernel memory when it exits even if nobody waits
+   for it, so kernel pool usage must not keep growing from round
+   to round. */
+
+#include <memstat.h>
+#include <procstat.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUND_CNT 8             /* Number of rounds. */
+#define DEPTH 4                 /* Depth of each child-bomb tree. */
+#define SLACK_PAGES 8           /* Allowed growth after the first round. */
+
+static struct procstat stats[64];
+
+/* Returns the number of live child-bomb processes. */
+static int
+bombs_alive (void)
+{
+  int cnt = procstat (stats, sizeof stats / sizeof *stats);
+  int alive = 0;
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    if (!strcmp (stats[i].name, "child-bomb"))
+      alive++;
+  return alive;
+}
+
+void
+test_main (void)
+{
+  struct memstat ms;
+  char cmd_line[32];
+  unsigned first_used = 0;
+  int round;
+
+  snprintf (cmd_line, sizeof cmd_line, "child-bomb %d", DEPTH);
+  for (round = 0; round < ROUND_CNT; round++)
+    {
+      pid_t pid = exec (cmd_line);
+      if (pid == PID_ERROR)
+        fail ("exec failed in round %d", round);
+      if (wait (pid) != DEPTH)
+        fail ("wrong exit status in round %d", round);
+
+      /* The orphans may still be running. */
+      while (bombs_alive () > 0)
+        continue;
+
+      if (!memstat (&ms))
+        fail ("memstat failed");
+      msg ("round %d: %u of %u kernel pages in use",
+           round, ms.kernel_used, ms.kernel_total);
+      if (round == 0)
+        first_used = ms.kernel_used;
+    }
+
+  if (ms.kernel_used > first_used + SLACK_PAGES)
+    fail ("kernel pool grew from %u to %u pages",
+          first_used, ms.kernel_used);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Page counts depend on the kernel; the test itself checks that
+# they stay put from round to round.
+s/round (\d+): \d+ of \d+ kernel/round $1: N of N kernel/ foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(exec-stress) begin
+(exec-stress) round 0: N of N kernel pages in use
+(exec-stress) round 1: N of N kernel pages in use
+(exec-stress) round 2: N of N kernel pages in use
+(exec-stress) round 3: N of N kernel pages in use
+(exec-stress) round 4: N of N kernel pages in use
+(exec-stress) round 5: N of N kernel pages in use
+(exec-stress) round 6: N of N kernel pages in use
+(exec-stress) round 7: N of N kernel pages in use
+(exec-stress) end
+EOF
+pass;
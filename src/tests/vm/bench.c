@@ -0,0 +1,17 @@
+/* Helpers for the VM benchmarks. */
+
+#include "tests/vm/bench.h"
+#include <memstat.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Returns the number of pages in use in the user pool. */
+int
+user_pages_used (void)
+{
+  struct memstat ms;
+
+  if (!memstat (&ms))
+    fail ("memstat failed");
+  return ms.user_used;
+}
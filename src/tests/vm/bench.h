@@ -0,0 +1,8 @@
+#ifndef TESTS_VM_BENCH_H
+#define TESTS_VM_BENCH_H
+
+/* Helpers for the VM benchmarks. */
+
+int user_pages_used (void);
+
+#endif /* tests/vm/bench.h */
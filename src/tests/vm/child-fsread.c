@@ -0,0 +1,36 @@
+/* Child process of io-overlap.
+   Reads the file named by its last argument front to back a few
+   times, checking that each block holds its own index, as written
+   by the parent. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-fsread";
+
+#define BLOCK_SIZE 4096
+#define PASS_CNT 4
+
+static char buf[BLOCK_SIZE];
+
+int
+main (int argc, char *argv[])
+{
+  const char *file_name = argv[argc - 1];
+  int fd, pass;
+
+  quiet = true;
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      int block, n;
+
+      seek (fd, 0);
+      for (block = 0; (n = read (fd, buf, BLOCK_SIZE)) > 0; block++)
+        if (n != BLOCK_SIZE || buf[0] != (char) block
+            || buf[BLOCK_SIZE - 1] != (char) block)
+          fail ("block %d of \"%s\" is wrong", block, file_name);
+    }
+  close (fd);
+  return 0x42;
+}
@@ -0,0 +1,21 @@
+/* Child process of fork-bench.
+
+   Has the same large heap as fork-bench, touches all of it as
+   fork-bench's parent does before forking, and exits. */
+
+#include "tests/lib.h"
+
+const char *test_name = "child-heap";
+
+#define HEAP_SIZE (512 * 1024)
+static char heap[HEAP_SIZE];
+
+int
+main (void)
+{
+  size_t i;
+
+  for (i = 0; i < HEAP_SIZE; i += 4096)
+    heap[i] = 1;
+  return 0;
+}
@@ -0,0 +1,46 @@
+/* Child process of exec-large.
+
+   A large executable: half a megabyte of initialized read-only
+   data and as much zero-initialized data.  Reports how long it
+   took from the parent's exec() to here and how many pages it
+   had resident on arrival, then touches all of its data and
+   reports the resident pages again.
+
+   Takes the parent's uptime() at the time of exec() and the
+   user pool usage before exec() as arguments. */
+
+#include <stdlib.h>
+#include "tests/lib.h"
+#include "tests/vm/bench.h"
+
+const char *test_name = "child-large";
+
+#define SIZE (512 * 1024)
+static const char rodata[SIZE] = {1};
+static char bss[SIZE];
+
+int
+main (int argc, char *argv[])
+{
+  int now = uptime ();
+  int resident = user_pages_used ();
+  int pages_before;
+  int sum = 0;
+  size_t i;
+
+  if (argc != 3)
+    fail ("bad command-line arguments");
+  pages_before = atoi (argv[2]);
+  msg ("exec to first instruction: %d ticks", now - atoi (argv[1]));
+  msg ("resident at start: %d pages", resident - pages_before);
+
+  for (i = 0; i < SIZE; i += 4096)
+    {
+      sum += rodata[i];
+      bss[i] = 1;
+    }
+  msg ("resident after touching everything: %d pages",
+       user_pages_used () - pages_before);
+
+  return sum == 1 ? 0 : 1;
+}
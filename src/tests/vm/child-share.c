@@ -0,0 +1,45 @@
+/* Child process of exec-share.
+
+   Touches all of its read-only data, creates "ready-N", where N
+   is its first argument, to tell the parent it is fully resident,
+   and then stays alive until the parent removes "hold".
+
+   Also checks its initialized data, whose first page usually
+   starts in the same page of the executable as the last page of
+   text but holds more of it: mapped with the text page's
+   contents, it would read as zeros. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-share";
+
+#define SIZE (64 * 1024)
+static const char rodata[SIZE] = {1};
+static char data[] = "initialized data";
+
+int
+main (int argc, char *argv[])
+{
+  char name[16];
+  int sum = 0;
+  size_t i;
+  int fd;
+
+  if (argc != 2)
+    fail ("bad command-line arguments");
+  if (strcmp (data, "initialized data"))
+    fail ("initialized data reads as \"%s\"", data);
+  for (i = 0; i < SIZE; i += 4096)
+    sum += rodata[i];
+
+  snprintf (name, sizeof name, "ready-%s", argv[1]);
+  if (!create (name, 0))
+    fail ("create \"%s\" failed", name);
+  while ((fd = open ("hold")) != -1)
+    close (fd);
+
+  return sum == 1 ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+/* Measures exec latency and memory use for a large executable.
+   Runs child-large, which has a megabyte of data, several times.
+   The child reports how many ticks passed between exec() and
+   its first instruction and how many pages it had resident then
+   and after touching all of its data. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define RUN_CNT 4
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      char cmd_line[64];
+      pid_t pid;
+
+      snprintf (cmd_line, sizeof cmd_line, "child-large %d %d",
+                uptime (), user_pages_used ());
+      pid = exec (cmd_line);
+      if (pid == PID_ERROR)
+        fail ("exec \"child-large\" failed");
+      if (wait (pid) != 0)
+        fail ("child-large reported bad data");
+    }
+}
@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings and page counts vary from run to run.
+s/^\(child-large\) (.*): -?\d+ (ticks|pages)$/(child-large) $1: N $2/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(exec-large) begin
+(child-large) exec to first instruction: N ticks
+(child-large) resident at start: N pages
+(child-large) resident after touching everything: N pages
+(child-large) exec to first instruction: N ticks
+(child-large) resident at start: N pages
+(child-large) resident after touching everything: N pages
+(child-large) exec to first instruction: N ticks
+(child-large) resident at start: N pages
+(child-large) resident after touching everything: N pages
+(child-large) exec to first instruction: N ticks
+(child-large) resident at start: N pages
+(child-large) resident after touching everything: N pages
+(exec-large) end
+EOF
+pass;
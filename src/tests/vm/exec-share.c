@@ -0,0 +1,61 @@
+/* Measures how many user pages concurrent instances of the same
+   executable keep resident.  Starts one instance of child-share,
+   then more, and reports the user pages in use once each has
+   touched all of its text and read-only data.  With text shared
+   between processes, each instance after the first should add
+   only its private data and stack. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define CHILD_CNT 20
+
+/* Waits until child I has created its "ready" file. */
+static void
+wait_ready (int i)
+{
+  char name[16];
+  int fd;
+
+  snprintf (name, sizeof name, "ready-%d", i);
+  while ((fd = open (name)) == -1)
+    continue;
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int before, one = 0;
+  int i;
+
+  CHECK (create ("hold", 0), "create \"hold\"");
+  before = user_pages_used ();
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      char cmd_line[32];
+
+      snprintf (cmd_line, sizeof cmd_line, "child-share %d", i);
+      if ((children[i] = exec (cmd_line)) == PID_ERROR)
+        fail ("exec \"%s\" failed", cmd_line);
+      if (i == 0)
+        {
+          wait_ready (0);
+          one = user_pages_used () - before;
+        }
+    }
+  for (i = 1; i < CHILD_CNT; i++)
+    wait_ready (i);
+  msg ("1 instance: %d pages resident", one);
+  msg ("%d instances: %d pages resident", CHILD_CNT,
+       user_pages_used () - before);
+
+  CHECK (remove ("hold"), "remove \"hold\"");
+  for (i = 0; i < CHILD_CNT; i++)
+    if (wait (children[i]) != 0)
+      fail ("child %d failed", i);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Page counts depend on the kernel.
+s/(instances?): -?\d+ pages resident$/$1: N pages resident/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(exec-share) begin
+(exec-share) create "hold"
+(exec-share) 1 instance: N pages resident
+(exec-share) 20 instances: N pages resident
+(exec-share) remove "hold"
+(exec-share) end
+EOF
+pass;
@@ -0,0 +1,85 @@
+/* Causes page faults of several kinds and reports them, with the
+   kernel's fault latency histogram, as seen through faultstat().
+   Checks that the process's own counts went up where expected. */
+
+#include <faultstat.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ZERO_PAGES 16
+#define STACK_PAGES 4
+
+static char bss[ZERO_PAGES * PAGE_SIZE];
+static struct faultstat before, after;
+
+static const char *names[FAULT_TYPE_CNT] =
+  {"file", "swap", "zero", "cow", "stack", "invalid"};
+
+/* Touches STACK_PAGES pages of stack below the current one. */
+static void __attribute__ ((noinline))
+grow_stack (void)
+{
+  volatile char frame[STACK_PAGES * PAGE_SIZE];
+  size_t i;
+
+  for (i = 0; i < sizeof frame; i += PAGE_SIZE)
+    frame[i] = 1;
+}
+
+/* Returns the histogram bucket that holds the median of HIST. */
+static int
+median_bucket (const unsigned long long hist[FAULT_HIST_CNT])
+{
+  unsigned long long cnt = 0, sum = 0;
+  int i;
+
+  for (i = 0; i < FAULT_HIST_CNT; i++)
+    cnt += hist[i];
+  for (i = 0; i < FAULT_HIST_CNT - 1; i++)
+    if ((sum += hist[i]) * 2 >= cnt)
+      break;
+  return i;
+}
+
+/* Returns how many faults of TYPE this process took since the
+   first faultstat(). */
+static int
+delta (int type)
+{
+  return after.process[type] - before.process[type];
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int type;
+  pid_t pid;
+
+  CHECK (faultstat (&before), "faultstat");
+
+  for (i = 0; i < sizeof bss; i += PAGE_SIZE)
+    bss[i] = 1;
+  grow_stack ();
+  pid = fork ();
+  if (pid == 0)
+    exit (0);
+  CHECK (pid != PID_ERROR && wait (pid) == 0, "fork and wait");
+  for (i = 0; i < sizeof bss; i += PAGE_SIZE)
+    bss[i] = 2;
+
+  CHECK (faultstat (&after), "faultstat");
+  for (type = 0; type < FAULT_TYPE_CNT; type++)
+    msg ("%s: %d here, %d in all, median 2^%d cycles", names[type],
+         delta (type), (int) after.total[type],
+         median_bucket (after.hist[type]));
+
+  if (delta (FAULT_ZERO) < ZERO_PAGES - 1)
+    fail ("too few zero-fill faults");
+  if (delta (FAULT_STACK) == 0)
+    fail ("no stack growth faults");
+  if (delta (FAULT_COW) == 0)
+    fail ("no copy-on-write faults");
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Counts and latencies vary from run to run; the test itself checks
+# that the expected kinds of fault happened.
+s/: \d+ here, \d+ in all, median 2\^\d+ cycles$/: N here, N in all, median 2^N cycles/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(fault-stat) begin
+(fault-stat) faultstat
+(fault-stat) fork and wait
+(fault-stat) faultstat
+(fault-stat) file: N here, N in all, median 2^N cycles
+(fault-stat) swap: N here, N in all, median 2^N cycles
+(fault-stat) zero: N here, N in all, median 2^N cycles
+(fault-stat) cow: N here, N in all, median 2^N cycles
+(fault-stat) stack: N here, N in all, median 2^N cycles
+(fault-stat) invalid: N here, N in all, median 2^N cycles
+(fault-stat) end
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* Compares the cost of fork() with that of exec() for a process
+   with a large heap.  Touches half a megabyte of heap, then
+   times a series of fork()s whose children exit at once against
+   a series of exec()s of child-heap, which has the same heap
+   and touches it before exiting.  Along the way, checks that a
+   child's writes to the heap are not seen by the parent. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define HEAP_SIZE (512 * 1024)
+#define RUN_CNT 16
+
+static char heap[HEAP_SIZE];
+
+void
+test_main (void)
+{
+  int start, i;
+  size_t j;
+  pid_t pid;
+
+  for (j = 0; j < HEAP_SIZE; j += 4096)
+    heap[j] = 1;
+
+  /* Copy-on-write check. */
+  pid = fork ();
+  if (pid == 0)
+    {
+      for (j = 0; j < HEAP_SIZE; j += 4096)
+        if (heap[j] != 1)
+          exit (1);
+      heap[0] = 2;
+      exit (heap[0] == 2 ? 0 : 1);
+    }
+  CHECK (pid != PID_ERROR, "fork");
+  CHECK (wait (pid) == 0, "child saw and changed its copy of the heap");
+  CHECK (heap[0] == 1, "parent's heap is unchanged");
+
+  start = uptime ();
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      pid = fork ();
+      if (pid == 0)
+        exit (0);
+      if (pid == PID_ERROR || wait (pid) != 0)
+        fail ("fork %d failed", i);
+    }
+  msg ("%d fork+exit: %d ticks", RUN_CNT, uptime () - start);
+
+  start = uptime ();
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      pid = exec ("child-heap");
+      if (pid == PID_ERROR || wait (pid) != 0)
+        fail ("exec %d failed", i);
+    }
+  msg ("%d exec+exit: %d ticks", RUN_CNT, uptime () - start);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings vary from run to run.
+s/exit: \d+ ticks$/exit: N ticks/ foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(fork-bench) begin
+(fork-bench) fork
+(fork-bench) child saw and changed its copy of the heap
+(fork-bench) parent's heap is unchanged
+(fork-bench) 16 fork+exit: N ticks
+(fork-bench) 16 exec+exit: N ticks
+(fork-bench) end
+EOF
+pass;
@@ -0,0 +1,82 @@
+/* Measures how well file system and swap traffic overlap.  The
+   file system lives on the first ATA channel and swap on the
+   second, so a process reading files and processes paging should
+   be able to keep both channels busy at once.  Times a
+   child-fsread reading a file too big for the buffer cache and
+   CHILD_CNT child-linear processes competing for memory, first
+   each on its own and then all together, and reports, from
+   diskstat(), how busy each channel was and for how long both
+   were busy at once. */
+
+#include <diskstat.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (256 * 1024)
+#define BLOCK_SIZE 4096
+#define CHILD_CNT 3
+
+static char buf[BLOCK_SIZE];
+
+/* Returns N as a percentage of D, or 0 if D is 0. */
+static int
+percent (long long n, long long d)
+{
+  return d > 0 ? n * 100 / d : 0;
+}
+
+/* Starts child-fsread if FS is true and CHILD_CNT child-linear
+   processes if SWAP is true, waits for them all, and reports the
+   elapsed ticks and channel utilization as WHAT. */
+static void
+run (const char *what, bool fs, bool swap)
+{
+  pid_t children[CHILD_CNT + 1];
+  struct diskstat before, after;
+  long long ticks;
+  int cnt = 0;
+  int i;
+
+  CHECK (diskstat (&before), "diskstat");
+  if (fs)
+    CHECK ((children[cnt++] = exec ("child-fsread data")) != -1,
+           "exec \"child-fsread data\"");
+  if (swap)
+    for (i = 0; i < CHILD_CNT; i++)
+      CHECK ((children[cnt++] = exec ("child-linear")) != -1,
+             "exec \"child-linear\"");
+  for (i = 0; i < cnt; i++)
+    CHECK (wait (children[i]) == 0x42, "wait for child %d", i);
+  CHECK (diskstat (&after), "diskstat");
+
+  ticks = after.uptime - before.uptime;
+  msg ("%s: %lld ticks, hd0 busy %d%%, hd1 busy %d%%, "
+       "both busy %lld ticks",
+       what, ticks,
+       percent (after.busy_ticks[0] - before.busy_ticks[0], ticks),
+       percent (after.busy_ticks[1] - before.busy_ticks[1], ticks),
+       after.overlap_ticks - before.overlap_ticks);
+}
+
+void
+test_main (void)
+{
+  int fd;
+  size_t ofs;
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    {
+      memset (buf, ofs / BLOCK_SIZE, BLOCK_SIZE);
+      if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write %zu bytes at offset %zu failed", BLOCK_SIZE, ofs);
+    }
+  close (fd);
+
+  run ("file system only", true, false);
+  run ("swap only", false, true);
+  run ("both together", true, true);
+}
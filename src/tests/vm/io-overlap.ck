@@ -0,0 +1,46 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# child-fsread runs alongside the parent, so its line may land
+# anywhere; count it and drop it.  Timings vary from run to run.
+fail "child-fsread should open \"data\" twice\n"
+  if grep (/^\(child-fsread\) open "data"$/, @output) != 2;
+@output = grep (!/^\(child-fsread\) open "data"$/, @output);
+s/: \d+ ticks, hd0 busy \d+%, hd1 busy \d+%, both busy \d+ ticks$/: N ticks, hd0 busy N%, hd1 busy N%, both busy N ticks/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(io-overlap) begin
+(io-overlap) create "data"
+(io-overlap) open "data"
+(io-overlap) diskstat
+(io-overlap) exec "child-fsread data"
+(io-overlap) wait for child 0
+(io-overlap) diskstat
+(io-overlap) file system only: N ticks, hd0 busy N%, hd1 busy N%, both busy N ticks
+(io-overlap) diskstat
+(io-overlap) exec "child-linear"
+(io-overlap) exec "child-linear"
+(io-overlap) exec "child-linear"
+(io-overlap) wait for child 0
+(io-overlap) wait for child 1
+(io-overlap) wait for child 2
+(io-overlap) diskstat
+(io-overlap) swap only: N ticks, hd0 busy N%, hd1 busy N%, both busy N ticks
+(io-overlap) diskstat
+(io-overlap) exec "child-fsread data"
+(io-overlap) exec "child-linear"
+(io-overlap) exec "child-linear"
+(io-overlap) exec "child-linear"
+(io-overlap) wait for child 0
+(io-overlap) wait for child 1
+(io-overlap) wait for child 2
+(io-overlap) wait for child 3
+(io-overlap) diskstat
+(io-overlap) both together: N ticks, hd0 busy N%, hd1 busy N%, both busy N ticks
+(io-overlap) end
+EOF
+pass;
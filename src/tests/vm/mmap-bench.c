@@ -0,0 +1,92 @@
+/* Compares copying a file with read() and write() against
+   copying it through memory mappings, the way the cp and mcp
+   examples do, and reports the ticks each took.  Also checks
+   that both copies came out right. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define FILE_SIZE (256 * 1024)
+#define CHUNK_SIZE 4096
+#define SRC_MAP ((void *) 0x10000000)
+#define DST_MAP ((void *) 0x20000000)
+
+static char buf[CHUNK_SIZE];
+
+/* Creates NAME, FILE_SIZE bytes long, and returns an open fd. */
+static int
+create_file (const char *name)
+{
+  int fd;
+
+  CHECK (create (name, FILE_SIZE), "create \"%s\"", name);
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  return fd;
+}
+
+/* Checks that NAME holds the pattern written by test_main(). */
+static void
+verify (const char *name)
+{
+  int fd, ofs;
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\" for verification", name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      int i;
+
+      if (read (fd, buf, CHUNK_SIZE) != CHUNK_SIZE)
+        fail ("read \"%s\" at %d failed", name, ofs);
+      for (i = 0; i < CHUNK_SIZE; i++)
+        if (buf[i] != (char) ((ofs + i) / 7))
+          fail ("\"%s\" byte %d is wrong", name, ofs + i);
+    }
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  int src, dst, ofs, start;
+  mapid_t src_map, dst_map;
+
+  src = create_file ("src");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    {
+      int i;
+
+      for (i = 0; i < CHUNK_SIZE; i++)
+        buf[i] = (ofs + i) / 7;
+      if (write (src, buf, CHUNK_SIZE) != CHUNK_SIZE)
+        fail ("write \"src\" failed");
+    }
+
+  /* Copy with read() and write(), like cp. */
+  dst = create_file ("copy");
+  start = uptime ();
+  seek (src, 0);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CHUNK_SIZE)
+    if (read (src, buf, CHUNK_SIZE) != CHUNK_SIZE
+        || write (dst, buf, CHUNK_SIZE) != CHUNK_SIZE)
+      fail ("copy at %d failed", ofs);
+  msg ("read/write copy: %d ticks", uptime () - start);
+  close (dst);
+
+  /* Copy through mappings, like mcp. */
+  dst = create_file ("mcopy");
+  start = uptime ();
+  CHECK ((src_map = mmap (src, SRC_MAP)) != MAP_FAILED, "mmap \"src\"");
+  CHECK ((dst_map = mmap (dst, DST_MAP)) != MAP_FAILED, "mmap \"mcopy\"");
+  memcpy (DST_MAP, SRC_MAP, FILE_SIZE);
+  munmap (src_map);
+  munmap (dst_map);
+  msg ("mmap copy: %d ticks", uptime () - start);
+  close (dst);
+  close (src);
+
+  verify ("copy");
+  verify ("mcopy");
+}
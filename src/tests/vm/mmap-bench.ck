@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings vary from run to run.
+s/copy: \d+ ticks$/copy: N ticks/ foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(mmap-bench) begin
+(mmap-bench) create "src"
+(mmap-bench) open "src"
+(mmap-bench) create "copy"
+(mmap-bench) open "copy"
+(mmap-bench) read/write copy: N ticks
+(mmap-bench) create "mcopy"
+(mmap-bench) open "mcopy"
+(mmap-bench) mmap "src"
+(mmap-bench) mmap "mcopy"
+(mmap-bench) mmap copy: N ticks
+(mmap-bench) open "copy" for verification
+(mmap-bench) open "mcopy" for verification
+(mmap-bench) end
+EOF
+pass;
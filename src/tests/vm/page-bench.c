@@ -0,0 +1,57 @@
+/* Measures paging throughput.  Sweeps a buffer larger than the
+   user pool, first writing and then reading every page, so that
+   each pass forces the whole buffer through swap, and reports
+   the rate of each pass in kB per second.  Then times four
+   child-linear processes competing for memory. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define SIZE (3 * 1024 * 1024)
+#define PAGE_SIZE 4096
+#define CHILD_CNT 4
+
+static char buf[SIZE];
+
+/* Reports SIZE bytes moved between START and now as a rate. */
+static void
+report (const char *what, int start)
+{
+  int ticks = uptime () - start;
+
+  if (ticks == 0)
+    ticks = 1;
+  msg ("%s: %d ticks, %d kB/s", what, ticks,
+       SIZE / 1024 * TIMER_FREQ / ticks);
+}
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int start;
+  size_t i;
+
+  start = uptime ();
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    memset (buf + i, i / PAGE_SIZE, PAGE_SIZE);
+  report ("write sweep", start);
+
+  start = uptime ();
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    if (buf[i] != (char) (i / PAGE_SIZE)
+        || buf[i + PAGE_SIZE - 1] != (char) (i / PAGE_SIZE))
+      fail ("byte %zu has wrong value", i);
+  report ("read sweep", start);
+
+  start = uptime ();
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK ((children[i] = exec ("child-linear")) != -1,
+           "exec \"child-linear\"");
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0x42, "wait for child %zu", i);
+  msg ("%d child-linear: %d ticks", CHILD_CNT, uptime () - start);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings vary from run to run.
+s/sweep: \d+ ticks, \d+ kB\/s$/sweep: N ticks, N kB\/s/ foreach @output;
+s/child-linear: \d+ ticks$/child-linear: N ticks/ foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(page-bench) begin
+(page-bench) write sweep: N ticks, N kB/s
+(page-bench) read sweep: N ticks, N kB/s
+(page-bench) exec "child-linear"
+(page-bench) exec "child-linear"
+(page-bench) exec "child-linear"
+(page-bench) exec "child-linear"
+(page-bench) wait for child 0
+(page-bench) wait for child 1
+(page-bench) wait for child 2
+(page-bench) wait for child 3
+(page-bench) 4 child-linear: N ticks
+(page-bench) end
+EOF
+pass;
@@ -0,0 +1,107 @@
+/* Measures the copying saved by the page cache.  Runs
+   child-large twice, reporting how many of its page faults
+   mapped a page already in the cache rather than reading a copy
+   of its own, then reads a file front to back twice, the way cat
+   would, reporting how many bytes came from the cache.  Between
+   the passes over the file it rewrites one block, to check that
+   reads see the write. */
+
+#include <memstat.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/bench.h"
+
+#define RUN_CNT 2
+#define FILE_SIZE (64 * 1024)
+#define BLOCK_SIZE 4096
+#define CAT_SIZE 512            /* Bytes per read(), as by cat. */
+
+static char block[BLOCK_SIZE];
+
+/* Returns the page cache statistics. */
+static struct memstat
+get_stats (void)
+{
+  struct memstat ms;
+
+  CHECK (memstat (&ms), "memstat");
+  return ms;
+}
+
+/* Reads "data" in CAT_SIZE pieces, checking that block I holds I
+   everywhere, except for block CHANGED, which must hold 0xff. */
+static void
+cat (int changed)
+{
+  char buf[CAT_SIZE];
+  int fd, ofs;
+
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += CAT_SIZE)
+    {
+      int blk = ofs / BLOCK_SIZE;
+      char expect = blk == changed ? (char) 0xff : (char) blk;
+      int i;
+
+      if (read (fd, buf, CAT_SIZE) != CAT_SIZE)
+        fail ("short read at offset %d", ofs);
+      for (i = 0; i < CAT_SIZE; i++)
+        if (buf[i] != expect)
+          fail ("bad byte at offset %d", ofs + i);
+    }
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  struct memstat before, after;
+  int fd, i;
+
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      char cmd_line[64];
+      pid_t pid;
+
+      before = get_stats ();
+      snprintf (cmd_line, sizeof cmd_line, "child-large %d %d",
+                uptime (), user_pages_used ());
+      pid = exec (cmd_line);
+      if (pid == PID_ERROR)
+        fail ("exec \"child-large\" failed");
+      if (wait (pid) != 0)
+        fail ("child-large reported bad data");
+      after = get_stats ();
+      msg ("exec %d: %u pages mapped from cache (%u kB not copied)",
+           i, after.cache_mapped - before.cache_mapped,
+           (after.cache_mapped - before.cache_mapped) * 4);
+    }
+
+  CHECK (create ("data", FILE_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  for (i = 0; i < FILE_SIZE / BLOCK_SIZE; i++)
+    {
+      memset (block, i, BLOCK_SIZE);
+      if (write (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("write of block %d failed", i);
+    }
+
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      before = get_stats ();
+      cat (i == 0 ? -1 : 1);
+      after = get_stats ();
+      msg ("cat %d: %u of %d bytes read from cache, %u pages cached",
+           i, after.cache_read_bytes - before.cache_read_bytes, FILE_SIZE,
+           after.cache_pages);
+
+      memset (block, 0xff, BLOCK_SIZE);
+      seek (fd, BLOCK_SIZE);
+      if (write (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("rewrite of block 1 failed");
+    }
+  close (fd);
+}
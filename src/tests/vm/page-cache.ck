@@ -0,0 +1,41 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Timings and page counts vary from run to run.
+s/^\(child-large\) (.*): -?\d+ (ticks|pages)$/(child-large) $1: N $2/
+  foreach @output;
+s/: \d+ pages mapped from cache \(\d+ kB not copied\)$/: N pages mapped from cache (N kB not copied)/
+  foreach @output;
+s/: \d+ of 65536 bytes read from cache, \d+ pages cached$/: N of 65536 bytes read from cache, N pages cached/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(page-cache) begin
+(page-cache) memstat
+(child-large) exec to first instruction: N ticks
+(child-large) resident at start: N pages
+(child-large) resident after touching everything: N pages
+(page-cache) memstat
+(page-cache) exec 0: N pages mapped from cache (N kB not copied)
+(page-cache) memstat
+(child-large) exec to first instruction: N ticks
+(child-large) resident at start: N pages
+(child-large) resident after touching everything: N pages
+(page-cache) memstat
+(page-cache) exec 1: N pages mapped from cache (N kB not copied)
+(page-cache) create "data"
+(page-cache) open "data"
+(page-cache) memstat
+(page-cache) open "data"
+(page-cache) memstat
+(page-cache) cat 0: N of 65536 bytes read from cache, N pages cached
+(page-cache) memstat
+(page-cache) open "data"
+(page-cache) memstat
+(page-cache) cat 1: N of 65536 bytes read from cache, N pages cached
+(page-cache) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Measures the user memory that reading never-written data costs.
+   Reads every page of a large zero-initialized array, then
+   writes every page, and reports the user pages in use and the
+   reads served by the shared zero page after each pass. */
+
+#include <memstat.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (1024 * 1024)
+#define PAGE_SIZE 4096
+
+static char buf[SIZE];
+
+/* Reports user pages in use, relative to BASE, after pass WHAT. */
+static void
+report (const char *what, const struct memstat *base)
+{
+  struct memstat ms;
+
+  CHECK (memstat (&ms), "memstat");
+  msg ("after %s: %d pages resident, %d zero page hits", what,
+       (int) (ms.user_used - base->user_used),
+       (int) (ms.zero_page_hits - base->zero_page_hits));
+}
+
+void
+test_main (void)
+{
+  struct memstat base;
+  size_t i;
+  int sum = 0;
+
+  CHECK (memstat (&base), "memstat");
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    sum += buf[i];
+  if (sum != 0)
+    fail ("zero-initialized array is not zero");
+  report ("reading", &base);
+
+  for (i = 0; i < SIZE; i += PAGE_SIZE)
+    buf[i] = 1;
+  report ("writing", &base);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# Page counts depend on the kernel's page table layout.
+s/: -?\d+ pages resident, \d+ zero page hits$/: N pages resident, N zero page hits/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(page-zero) begin
+(page-zero) memstat
+(page-zero) memstat
+(page-zero) after reading: N pages resident, N zero page hits
+(page-zero) memstat
+(page-zero) after writing: N pages resident, N zero page hits
+(page-zero) end
+EOF
+pass;
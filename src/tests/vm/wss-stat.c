@@ -0,0 +1,70 @@
+/* Reports the kernel's working-set estimate for this process, as
+   seen through wssstat(), while it keeps a large array busy and
+   again after it settles down to a few pages of it.  Checks that
+   the estimate follows: it should cover most of the array at
+   first and shrink once most of it goes idle. */
+
+#include <string.h>
+#include <syscall.h>
+#include <wssstat.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define BUSY_PAGES 64           /* Pages touched at first. */
+#define IDLE_PAGES 4            /* Pages still touched later. */
+#define RUN_TICKS (2 * TIMER_FREQ) /* How long to keep each up. */
+
+static char buf[BUSY_PAGES * PAGE_SIZE];
+static struct wssstat stats[64];
+
+/* Writes to the first PAGES pages of BUF for RUN_TICKS ticks,
+   timed by uptime(), which keeps counting while we run. */
+static void
+touch (int pages)
+{
+  int start = uptime ();
+
+  while (uptime () - start < RUN_TICKS)
+    {
+      int i;
+
+      for (i = 0; i < pages; i++)
+        buf[i * PAGE_SIZE]++;
+    }
+}
+
+/* Returns this process's entry in the kernel's estimates. */
+static struct wssstat *
+find_self (void)
+{
+  int cnt = wssstat (stats, sizeof stats / sizeof *stats);
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    if (!strcmp (stats[i].name, test_name))
+      return &stats[i];
+  fail ("no wssstat entry for %s", test_name);
+}
+
+void
+test_main (void)
+{
+  struct wssstat *ws;
+  unsigned busy;
+
+  touch (BUSY_PAGES);
+  ws = find_self ();
+  msg ("busy: working set %u pages, %u resident", ws->wss, ws->rss);
+  if (ws->wss < BUSY_PAGES / 2)
+    fail ("working set misses most of the busy pages");
+  if (ws->wss > ws->rss)
+    fail ("working set larger than resident set");
+  busy = ws->wss;
+
+  touch (IDLE_PAGES);
+  ws = find_self ();
+  msg ("idle: working set %u pages, %u resident", ws->wss, ws->rss);
+  if (ws->wss >= busy)
+    fail ("working set did not shrink");
+}
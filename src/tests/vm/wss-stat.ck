@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+# The estimates depend on timing; the test itself checks that the
+# working set shrinks.
+s/: working set \d+ pages, \d+ resident$/: working set N pages, N resident/
+  foreach @output;
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(wss-stat) begin
+(wss-stat) busy: working set N pages, N resident
+(wss-stat) idle: working set N pages, N resident
+(wss-stat) end
+EOF
+pass;
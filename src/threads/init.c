@@ -19,6 +19,7 @@
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -34,6 +35,14 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #include "filesys/cache.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
+#endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/wss.h"
 #endif
 
 /* Amount of physical memory, in 4 kB pages. */
@@ -45,6 +54,11 @@ uint32_t *base_page_dir;
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
+
+/* -o crash-after=N: Crash once N sectors have been written to the
+   file system disk, counting from the start of the first run
+   action, or -1 not to crash. */
+static int crash_after = -1;
 #endif
 
 /* -q: Power off after kernel tasks complete? */
@@ -55,10 +69,14 @@ static void paging_init (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
+#ifdef FILESYS
+static void parse_fs_option (char *option);
+#endif
 static void run_actions (char **argv);
 static void usage (void);
 
 static void print_stats (void);
+static void shut_down (void) NO_RETURN;
 
 
 int main (void) NO_RETURN;
@@ -103,6 +121,7 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
@@ -110,11 +129,20 @@ main (void)
   serial_init_queue ();
   timer_calibrate ();
 
+#ifdef VM
+  /* The page cache lives in the frame table, so the file system
+     needs it. */
+  frame_init ();
+#endif
 #ifdef FILESYS
   /* Initialize file system. */
   disk_init ();
   filesys_init (format_filesys);
   
+#endif
+#ifdef VM
+  swap_init ();
+  wss_init ();
 #endif
 
   printf ("Boot complete.\n");
@@ -241,6 +269,22 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-nodma"))
+        disk_use_dma = false;
+      else if (!strcmp (name, "-dtrace"))
+        disk_trace_dump = true;
+      else if (!strcmp (name, "-ds"))
+        {
+          if (value == NULL || !disk_set_scheduler (value))
+            PANIC ("unknown disk scheduler `%s' (use -h for help)",
+                   value != NULL ? value : "");
+        }
+      else if (!strcmp (name, "-o"))
+        {
+          if (argv[1] == NULL)
+            PANIC ("option `-o' needs an argument (use -h for help)");
+          parse_fs_option (*++argv);
+        }
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
@@ -249,6 +293,10 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-sl"))
+        stack_limit = (size_t) atoi (value) * 1024;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -257,12 +305,39 @@ parse_options (char **argv)
   return argv;
 }
 
+#ifdef FILESYS
+/* Parses OPTION, given to "-o", which is NAME=VALUE. */
+static void
+parse_fs_option (char *option)
+{
+  char *save_ptr;
+  char *name = strtok_r (option, "=", &save_ptr);
+  char *value = strtok_r (NULL, "", &save_ptr);
+
+  if (name != NULL && !strcmp (name, "crash-after") && value != NULL)
+    crash_after = atoi (value);
+  else
+    PANIC ("unknown file system option `%s' (use -h for help)", option);
+}
+#endif
+
 /* Runs the task specified in ARGV[1]. */
 static void
 run_task (char **argv)
 {
   const char *task = argv[1];
   
+#ifdef FILESYS
+  if (crash_after >= 0)
+    {
+      /* Start from a file system that is all on disk, so that
+         only what this action writes is at stake. */
+      inode_flush_all ();
+      cache_checkpoint ();
+      disk_crash_after (filesys_disk, crash_after);
+      crash_after = -1;
+    }
+#endif
   printf ("Executing '%s':\n", task);
 #ifdef USERPROG
   process_wait (process_execute (task));
@@ -349,10 +424,21 @@ usage (void)
           "  -h                 Print this help message and power off.\n"
           "  -q                 Power off VM after actions or on panic.\n"
           "  -f                 Format file system disk during startup.\n"
+#ifdef FILESYS
+          "  -nodma             Use PIO, not DMA, for disk transfers.\n"
+          "  -dtrace            Print the disk I/O trace at shutdown.\n"
+          "  -ds=NAME           Schedule disk requests with NAME: fifo,\n"
+          "                     clook or deadline (the default).\n"
+          "  -o crash-after=N   Crash once N sectors are written to the\n"
+          "                     file system disk by the run actions.\n"
+#endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -sl=KB             Limit user stacks to KB kilobytes.\n"
 #endif
           );
   power_off ();
@@ -364,14 +450,31 @@ usage (void)
 void
 power_off (void) 
 {
-  const char s[] = "Shutdown";
-  const char *p;
-
 #ifdef FILESYS
   filesys_done ();
 #endif
 
   print_stats ();
+  shut_down ();
+}
+
+/* Powers down the machine at once, as if the power had failed:
+   unlike power_off(), leaves the file system as it is on disk.
+   Still prints the statistics, for whoever is testing crash
+   recovery. */
+void
+crash_power_off (void)
+{
+  print_stats ();
+  shut_down ();
+}
+
+/* Tells Bochs or QEMU to power off. */
+static void
+shut_down (void)
+{
+  const char s[] = "Shutdown";
+  const char *p;
 
   printf ("Powering off...\n");
   serial_flush ();
@@ -391,10 +494,23 @@ print_stats (void)
   thread_print_stats ();
 #ifdef FILESYS
   disk_print_stats ();
+  cache_print_stats ();
+  journal_print_stats ();
+  inode_print_stats ();
+  if (disk_trace_dump)
+    disk_print_trace ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  frame_print_stats ();
+  swap_print_stats ();
+  wss_print_stats ();
+#endif
+#ifdef LOCKSTAT
+  lockstat_print_stats ();
+#endif
 }
@@ -16,5 +16,6 @@ extern uint32_t *base_page_dir;
 extern bool power_off_when_done;
 
 void power_off (void) NO_RETURN;
+void crash_power_off (void) NO_RETURN;
 
 #endif /* threads/init.h */
@@ -155,6 +155,20 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Stores the number of pages in use in the user pool, if
+   PAL_USER is set in FLAGS, or the kernel pool otherwise, into
+   *USED, and the size of that pool into *TOTAL. */
+void
+palloc_get_stats (enum palloc_flags flags, size_t *used, size_t *total)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+
+  lock_acquire (&pool->lock);
+  *total = bitmap_size (pool->used_map);
+  *used = bitmap_count (pool->used_map, 0, *total, true);
+  lock_release (&pool->lock);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -171,7 +185,7 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
+  lock_init_named (&p->lock, name);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
 }
@@ -31,6 +31,13 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef LOCKSTAT
+#include "devices/timer.h"
+
+static void lockstat_init (struct lockstat *, const char *name);
+static void lockstat_account (struct lockstat *, bool contended,
+                              int64_t start);
+#endif
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -48,6 +55,22 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   list_init (&sema->waiters);
+#ifdef LOCKSTAT
+  lockstat_init (&sema->stat, NULL);
+#endif
+}
+
+/* Initializes SEMA to VALUE, as sema_init(), and gives it NAME
+   for the lock contention profiler.  NAME must outlive SEMA,
+   and in -DLOCKSTAT kernels SEMA must never be freed. */
+void
+sema_init_named (struct semaphore *sema, unsigned value,
+                 const char *name UNUSED)
+{
+  sema_init (sema, value);
+#ifdef LOCKSTAT
+  lockstat_init (&sema->stat, name);
+#endif
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,19 +84,42 @@ sema_init (struct semaphore *sema, unsigned value)
 void
 sema_down (struct semaphore *sema) 
 {
+  struct thread *curr = thread_current ();
   enum intr_level old_level;
+  bool set_reason;
+#ifdef LOCKSTAT
+  bool contended;
+  int64_t start = 0;
+#endif
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
+  /* Charge blocked time to the semaphore unless our caller
+     (e.g. lock_acquire()) already named a more specific reason. */
+  set_reason = curr->wait_reason == WAIT_OTHER;
+  if (set_reason)
+    curr->wait_reason = WAIT_SEMA;
+
   old_level = intr_disable ();
+#ifdef LOCKSTAT
+  contended = sema->value == 0;
+  if (contended)
+    start = timer_ticks ();
+#endif
   while (sema->value == 0) 
     {
-      list_push_back (&sema->waiters, &thread_current ()->elem);
+      list_push_back (&sema->waiters, &curr->elem);
       thread_block ();
     }
   sema->value--;
+#ifdef LOCKSTAT
+  lockstat_account (&sema->stat, contended, start);
+#endif
   intr_set_level (old_level);
+
+  if (set_reason)
+    curr->wait_reason = WAIT_OTHER;
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -94,6 +140,9 @@ sema_try_down (struct semaphore *sema)
     {
       sema->value--;
       success = true; 
+#ifdef LOCKSTAT
+      lockstat_account (&sema->stat, false, 0);
+#endif
     }
   else
     success = false;
@@ -182,6 +231,18 @@ lock_init (struct lock *lock)
   sema_init (&lock->semaphore, 1);
 }
 
+/* Initializes LOCK, as lock_init(), and gives it NAME for the
+   lock contention profiler.  NAME must outlive LOCK, and in
+   -DLOCKSTAT kernels LOCK must never be freed. */
+void
+lock_init_named (struct lock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  lock->holder = NULL;
+  sema_init_named (&lock->semaphore, 1, name);
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
@@ -197,7 +258,9 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  thread_current ()->wait_reason = WAIT_LOCK;
   sema_down (&lock->semaphore);
+  thread_current ()->wait_reason = WAIT_OTHER;
   lock->holder = thread_current ();
 }
 
@@ -338,3 +401,309 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RW as an unheld reader-writer lock. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->readers_ok);
+  cond_init (&rw->writers_ok);
+  cond_init (&rw->upgrade_ok);
+  rw->readers = 0;
+  rw->waiting_readers = 0;
+  rw->waiting_writers = 0;
+  rw->read_batch = 0;
+  rw->writer = NULL;
+  rw->upgrader = NULL;
+}
+
+/* Returns true if a reader may enter RW now.  A reader may
+   enter when there is no writer, unless writers (or an
+   upgrader) are waiting and the reader is not part of a batch
+   released by the last writer. */
+static bool
+rwlock_read_ok (const struct rwlock *rw)
+{
+  return (rw->writer == NULL
+          && ((rw->waiting_writers == 0 && rw->upgrader == NULL)
+              || rw->read_batch > 0));
+}
+
+/* Returns true if a writer may enter RW now. */
+static bool
+rwlock_write_ok (const struct rwlock *rw)
+{
+  return (rw->writer == NULL && rw->readers == 0 && rw->upgrader == NULL
+          && rw->read_batch == 0);
+}
+
+/* Acquires RW for reading, sleeping until no writer holds or is
+   preferred for it. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->waiting_readers++;
+  while (!rwlock_read_ok (rw))
+    cond_wait (&rw->readers_ok, &rw->lock);
+  rw->waiting_readers--;
+  if (rw->read_batch > 0)
+    rw->read_batch--;
+  rw->readers++;
+  lock_release (&rw->lock);
+}
+
+/* Tries to acquire RW for reading without sleeping on it.
+   Returns true if successful. */
+bool
+rwlock_try_acquire_read (struct rwlock *rw)
+{
+  bool success;
+
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  success = rw->writer == NULL && rw->waiting_writers == 0
+            && rw->upgrader == NULL;
+  if (success)
+    rw->readers++;
+  lock_release (&rw->lock);
+  return success;
+}
+
+/* Releases a read hold on RW. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  rw->readers--;
+  if (rw->upgrader != NULL && rw->readers == 1)
+    cond_signal (&rw->upgrade_ok, &rw->lock);
+  else if (rw->readers == 0)
+    {
+      /* An unused batch of readers is forfeited once the lock
+         drains, so that a waiting writer can get in. */
+      if (rw->waiting_readers == 0)
+        rw->read_batch = 0;
+      if (rw->waiting_writers > 0)
+        cond_signal (&rw->writers_ok, &rw->lock);
+    }
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until it is free. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  struct thread *curr = thread_current ();
+
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->waiting_writers++;
+  while (!rwlock_write_ok (rw))
+    cond_wait (&rw->writers_ok, &rw->lock);
+  rw->waiting_writers--;
+  rw->writer = curr;
+  lock_release (&rw->lock);
+}
+
+/* Tries to acquire RW for writing without sleeping on it.
+   Returns true if successful. */
+bool
+rwlock_try_acquire_write (struct rwlock *rw)
+{
+  bool success;
+
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  success = rwlock_write_ok (rw);
+  if (success)
+    rw->writer = thread_current ();
+  lock_release (&rw->lock);
+  return success;
+}
+
+/* Releases a write hold on RW.  Readers that queued up behind
+   this writer are let in as a batch ahead of any other waiting
+   writer. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer = NULL;
+  if (rw->waiting_readers > 0)
+    {
+      rw->read_batch = rw->waiting_readers;
+      cond_broadcast (&rw->readers_ok, &rw->lock);
+    }
+  else if (rw->waiting_writers > 0)
+    cond_signal (&rw->writers_ok, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Converts the running thread's read hold on RW into a write
+   hold, waiting for the other readers to leave.  The upgrading
+   thread is preferred over waiting writers.  Only one thread may
+   be upgrading at a time: if another already is, returns false
+   immediately, still holding RW for reading, and the caller
+   should release its read hold and acquire RW for writing
+   instead.  Returns true if the upgrade succeeded. */
+bool
+rwlock_upgrade (struct rwlock *rw)
+{
+  struct thread *curr = thread_current ();
+
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (rw->upgrader != NULL)
+    {
+      lock_release (&rw->lock);
+      return false;
+    }
+  rw->upgrader = curr;
+  while (rw->readers > 1)
+    cond_wait (&rw->upgrade_ok, &rw->lock);
+  rw->upgrader = NULL;
+  rw->readers = 0;
+  rw->read_batch = 0;
+  rw->writer = curr;
+  lock_release (&rw->lock);
+  return true;
+}
+
+/* Converts the running thread's write hold on RW into a read
+   hold, without letting any writer in between.  Waiting readers
+   are admitted along with us. */
+void
+rwlock_downgrade (struct rwlock *rw)
+{
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer = NULL;
+  rw->readers = 1;
+  if (rw->waiting_readers > 0)
+    {
+      rw->read_batch = rw->waiting_readers;
+      cond_broadcast (&rw->readers_ok, &rw->lock);
+    }
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the running thread holds RW for writing.
+   (Whether the running thread holds RW for reading is not
+   tracked.) */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+#ifdef LOCKSTAT
+/* Named semaphores and locks, for lockstat_print_stats(). */
+static struct list lockstat_list;
+static bool lockstat_list_ready;
+
+/* Clears STAT and, if NAME is non-null, registers it under
+   NAME. */
+static void
+lockstat_init (struct lockstat *stat, const char *name)
+{
+  enum intr_level old_level;
+
+  memset (stat, 0, sizeof *stat);
+  stat->name = name;
+  if (name == NULL)
+    return;
+
+  old_level = intr_disable ();
+  if (!lockstat_list_ready)
+    {
+      list_init (&lockstat_list);
+      lockstat_list_ready = true;
+    }
+  list_push_back (&lockstat_list, &stat->elem);
+  intr_set_level (old_level);
+}
+
+/* Records a successful down of STAT's semaphore by the running
+   thread.  If CONTENDED, the wait started at tick START.  Must
+   be called with interrupts off. */
+static void
+lockstat_account (struct lockstat *stat, bool contended, int64_t start)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  stat->acquire_cnt++;
+  if (contended)
+    {
+      int64_t wait = timer_ticks () - start;
+
+      stat->contended_cnt++;
+      stat->wait_ticks += wait;
+      if (wait >= stat->max_wait_ticks)
+        {
+          stat->max_wait_ticks = wait;
+          memcpy (stat->max_holder, stat->holder, sizeof stat->holder);
+        }
+    }
+  strlcpy (stat->holder, thread_name (), sizeof stat->holder);
+}
+
+/* Orders lockstats by decreasing total wait, then by decreasing
+   contended count. */
+static bool
+lockstat_more_contended (const struct list_elem *a_,
+                         const struct list_elem *b_, void *aux UNUSED)
+{
+  const struct lockstat *a = list_entry (a_, struct lockstat, elem);
+  const struct lockstat *b = list_entry (b_, struct lockstat, elem);
+
+  if (a->wait_ticks != b->wait_ticks)
+    return a->wait_ticks > b->wait_ticks;
+  return a->contended_cnt > b->contended_cnt;
+}
+
+/* Prints a table of named semaphores and locks, most contended
+   first. */
+void
+lockstat_print_stats (void)
+{
+  struct list_elem *e;
+
+  if (!lockstat_list_ready)
+    return;
+
+  list_sort (&lockstat_list, lockstat_more_contended, NULL);
+  printf ("Lockstat: %-16s %10s %10s %10s %8s  %s\n",
+          "name", "acquires", "contended", "wait", "max", "max holder");
+  for (e = list_begin (&lockstat_list); e != list_end (&lockstat_list);
+       e = list_next (e))
+    {
+      struct lockstat *stat = list_entry (e, struct lockstat, elem);
+      printf ("Lockstat: %-16s %10lld %10lld %10lld %8lld  %s\n",
+              stat->name, stat->acquire_cnt, stat->contended_cnt,
+              stat->wait_ticks, stat->max_wait_ticks,
+              stat->contended_cnt > 0 ? stat->max_holder : "-");
+    }
+}
+#endif /* LOCKSTAT */
@@ -4,14 +4,37 @@
 #include <list.h>
 #include <stdbool.h>
 
+#ifdef LOCKSTAT
+/* Contention statistics for a semaphore (and hence a lock).
+   Only present in kernels compiled with -DLOCKSTAT; objects
+   initialized with sema_init_named() or lock_init_named() are
+   listed by lockstat_print_stats() at shutdown, so they must
+   never be freed. */
+struct lockstat
+  {
+    const char *name;           /* Name, or a null pointer. */
+    struct list_elem elem;      /* Element in list of named objects. */
+    long long acquire_cnt;      /* Number of successful downs. */
+    long long contended_cnt;    /* Number of downs that had to wait. */
+    long long wait_ticks;       /* Total timer ticks spent waiting. */
+    long long max_wait_ticks;   /* Longest single wait. */
+    char holder[16];            /* Name of thread that last downed. */
+    char max_holder[16];        /* Holder during the longest wait. */
+  };
+#endif
+
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
     struct list waiters;        /* List of waiting threads. */
+#ifdef LOCKSTAT
+    struct lockstat stat;       /* Contention statistics. */
+#endif
   };
 
 void sema_init (struct semaphore *, unsigned value);
+void sema_init_named (struct semaphore *, unsigned value, const char *name);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
@@ -25,6 +48,7 @@ struct lock
   };
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -41,6 +65,41 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.
+   Any number of readers or a single writer may hold it.  Writers
+   are preferred: once a writer is waiting, newly arriving
+   readers queue behind it, but the readers that were already
+   waiting when a writer releases the lock are admitted as a
+   batch before the next writer, so neither side starves. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition readers_ok; /* Signaled when readers may enter. */
+    struct condition writers_ok; /* Signaled when a writer may enter. */
+    struct condition upgrade_ok; /* Signaled when the upgrader may enter. */
+    int readers;                /* Number of readers holding the lock. */
+    int waiting_readers;        /* Number of readers waiting. */
+    int waiting_writers;        /* Number of writers waiting. */
+    int read_batch;             /* Readers admitted ahead of writers. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+    struct thread *upgrader;    /* Reader waiting to upgrade, if any. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+bool rwlock_try_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+bool rwlock_try_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_upgrade (struct rwlock *);
+void rwlock_downgrade (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+#ifdef LOCKSTAT
+void lockstat_print_stats (void);
+#endif
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
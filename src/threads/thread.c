@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "filesys/inode.h"
@@ -32,6 +33,21 @@ struct semaphore file_sema;
    that are ready to run but not actually running. */
 static struct list ready_list;
 
+/* List of all processes.  Processes are added to this list
+   when they are first scheduled and removed when they exit. */
+static struct list all_list;
+
+/* List of processes blocked in thread_sleep(), in order of
+   increasing wakeup_tick. */
+static struct list sleep_list;
+
+/* Pages of dead threads, kept for reuse by thread_create() so
+   that spawning a thread need not go back to the page allocator.
+   Linked through the dead threads' `elem' members. */
+static struct list free_thread_pages;
+static size_t free_thread_page_cnt;
+#define FREE_THREAD_PAGES_MAX 16  /* Most pages kept on the list. */
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -57,6 +73,7 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+static bool slice_expired;      /* Yield was forced by the timer. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -71,6 +88,8 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static struct thread *alloc_thread_page (void);
+static void free_thread_page (struct thread *);
 static void schedule (void);
 void schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
@@ -96,9 +115,12 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
+  lock_init_named (&tid_lock, "tid_lock");
   list_init (&ready_list);
-  sema_init (&file_sema, 1);
+  list_init (&all_list);
+  list_init (&sleep_list);
+  list_init (&free_thread_pages);
+  sema_init_named (&file_sema, 1, "file_sema");
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -141,18 +163,96 @@ thread_tick (void)
 #endif
   else
     kernel_ticks++;
+  t->run_ticks++;
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
-    intr_yield_on_return ();
+    {
+      slice_expired = true;
+      intr_yield_on_return ();
+    }
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics, followed by a line for each live
+   thread: run/ready ticks, blocked ticks by wait reason
+   (lock/sema/disk/sleep/other) and voluntary/involuntary context
+   switches. */
 void
 thread_print_stats (void)
 {
+  struct list_elem *e;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      printf ("  tid %d (%s): %lld run, %lld ready, "
+              "%lld/%lld/%lld/%lld/%lld blocked, %u/%u switches\n",
+              t->tid, t->name, t->run_ticks, t->ready_ticks,
+              t->blocked_ticks[WAIT_LOCK], t->blocked_ticks[WAIT_SEMA],
+              t->blocked_ticks[WAIT_DISK], t->blocked_ticks[WAIT_SLEEP],
+              t->blocked_ticks[WAIT_OTHER],
+              t->voluntary_switches, t->involuntary_switches);
+    }
+}
+
+/* Copies an accounting snapshot of up to MAX live threads into
+   STATS and returns the number of entries filled in. */
+int
+thread_get_stats (struct procstat *stats, int max)
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  int64_t now;
+  int cnt = 0;
+
+  old_level = intr_disable ();
+  now = timer_ticks ();
+  for (e = list_begin (&all_list); e != list_end (&all_list) && cnt < max;
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      struct procstat *ps = &stats[cnt++];
+      int i;
+
+      ps->tid = t->tid;
+      strlcpy (ps->name, t->name, sizeof ps->name);
+      ps->status = t->status;
+      ps->wait_reason = t->wait_reason;
+      ps->run_ticks = t->run_ticks;
+      ps->ready_ticks = t->ready_ticks;
+      for (i = 0; i < WAIT_REASON_CNT; i++)
+        ps->blocked_ticks[i] = t->blocked_ticks[i];
+
+      /* The counters only take in a ready or blocked spell when
+         it ends, so add in the one still going on. */
+      if (t->status == THREAD_READY)
+        ps->ready_ticks += now - t->state_since;
+      else if (t->status == THREAD_BLOCKED)
+        ps->blocked_ticks[t->wait_reason] += now - t->state_since;
+      ps->voluntary_switches = t->voluntary_switches;
+      ps->involuntary_switches = t->involuntary_switches;
+    }
+  intr_set_level (old_level);
+
+  return cnt;
+}
+
+/* Invokes FUNC on every live thread, passing along AUX.  Must be
+   called with interrupts off. */
+void
+thread_foreach (thread_action_func *func, void *aux)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    func (list_entry (e, struct thread, allelem), aux);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -184,7 +284,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -192,11 +292,13 @@ thread_create (const char *name, int priority,
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
 
+#ifdef USERPROG
   /* get parent dir */
   struct thread *cur_t = thread_current();
   if(cur_t->dir != NULL){
     t->dir = dir_reopen(cur_t->dir);
   }
+#endif
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -227,10 +329,13 @@ thread_create (const char *name, int priority,
 void
 thread_block (void)
 {
+  struct thread *curr = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  curr->status = THREAD_BLOCKED;
+  curr->state_since = timer_ticks ();
   schedule ();
 }
 
@@ -246,6 +351,7 @@ void
 thread_unblock (struct thread *t)
 {
   enum intr_level old_level;
+  int64_t now;
 
   ASSERT (is_thread (t));
 
@@ -253,9 +359,53 @@ thread_unblock (struct thread *t)
   ASSERT (t->status == THREAD_BLOCKED);
   list_push_back (&ready_list, &t->elem);
   t->status = THREAD_READY;
+  now = timer_ticks ();
+  t->blocked_ticks[t->wait_reason] += now - t->state_since;
+  t->state_since = now;
+  intr_set_level (old_level);
+}
+
+/* Blocks the running thread until the timer reaches
+   WAKEUP_TICK.  Must be called with interrupts on. */
+void
+thread_sleep (int64_t wakeup_tick)
+{
+  struct thread *curr = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e;
+
+  ASSERT (!intr_context ());
+  ASSERT (curr != idle_thread);
+
+  old_level = intr_disable ();
+  curr->wakeup_tick = wakeup_tick;
+  for (e = list_begin (&sleep_list); e != list_end (&sleep_list);
+       e = list_next (e))
+    if (list_entry (e, struct thread, elem)->wakeup_tick > wakeup_tick)
+      break;
+  list_insert (e, &curr->elem);
+  curr->wait_reason = WAIT_SLEEP;
+  thread_block ();
+  curr->wait_reason = WAIT_OTHER;
   intr_set_level (old_level);
 }
 
+/* Wakes up every sleeping thread whose wakeup tick is at or
+   before NOW.  Called from the timer interrupt handler. */
+void
+thread_wakeup (int64_t now)
+{
+  while (!list_empty (&sleep_list))
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > now)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void)
@@ -303,6 +453,7 @@ thread_exit (void)
   /* Just set our status to dying and schedule another process.
      We will be destroyed during the call to schedule_tail(). */
   intr_disable ();
+  list_remove (&thread_current ()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -322,6 +473,7 @@ thread_yield (void)
   if (curr != idle_thread)
     list_push_back (&ready_list, &curr->elem);
   curr->status = THREAD_READY;
+  curr->state_since = timer_ticks ();
   schedule ();
   intr_set_level (old_level);
 }
@@ -446,6 +598,8 @@ is_thread (struct thread *t)
 static void
 init_thread (struct thread *t, const char *name, int priority)
 {
+  enum intr_level old_level;
+
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
   ASSERT (name != NULL);
@@ -456,28 +610,18 @@ init_thread (struct thread *t, const char *name, int priority)
   t->stack = (uint8_t *) t + PGSIZE;
   t->priority = priority;
   t->magic = THREAD_MAGIC;
+  t->wait_reason = WAIT_OTHER;
+  t->disk_tag = DISK_TAG_OTHER;
+  t->state_since = timer_ticks ();
 
-  int i;                    /* Init file descriptor. */
-  for(i = 0; i < 128; ++i)
-  {
-    t->f_d[i] = NULL;
-  }
-
-  sema_init(&(t->child_lock), 0);
-  // sema_init(&(t->load_lock), 0);
-  sema_init(&(t->memory_lock), 0);
-  sema_init(&(t->load_suc_lock), 0);
-  sema_init(&(t->wait_lock), 0);
-
-  sema_init(&(t->load_lock), 0);
-  sema_init(&(t->child_exit_lock), 0);
-  sema_init(&(t->exit_status_lock), 0);
-
-  t->wait = false;
-  t->success = false;
+  old_level = intr_disable ();
+  list_push_back (&all_list, &t->allelem);
+  intr_set_level (old_level);
 
-  list_init(&(t->child_list));
-  list_push_back(&(running_thread()->child_list), &(t->child_elem));
+  list_init (&t->children);
+#ifdef VM
+  list_init (&t->mappings);
+#endif
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -527,10 +671,18 @@ void
 schedule_tail (struct thread *prev)
 {
   struct thread *curr = running_thread ();
+  int64_t waited;
 
   ASSERT (intr_get_level () == INTR_OFF);
 
-  /* Mark us as running. */
+  /* Mark us as running.  The idle thread is picked while still
+     blocked, without going through thread_unblock(), so its wait
+     counts as blocked time rather than ready time. */
+  waited = timer_ticks () - curr->state_since;
+  if (curr->status == THREAD_BLOCKED)
+    curr->blocked_ticks[curr->wait_reason] += waited;
+  else
+    curr->ready_ticks += waited;
   curr->status = THREAD_RUNNING;
 
   /* Start new time slice. */
@@ -549,10 +701,51 @@ schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != curr);
-      palloc_free_page (prev);
+      free_thread_page (prev);
     }
 }
 
+/* Returns a page for a new thread, reusing the page of a dead
+   thread if one is available.  The page is not zeroed:
+   init_thread() clears the thread structure and the rest of the
+   page is stack.  Returns a null pointer if no page is
+   available. */
+static struct thread *
+alloc_thread_page (void)
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&free_thread_pages))
+    {
+      t = list_entry (list_pop_front (&free_thread_pages),
+                      struct thread, elem);
+      free_thread_page_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Releases the page of dead thread T, keeping it for reuse if
+   the free list is not full. */
+static void
+free_thread_page (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (free_thread_page_cnt < FREE_THREAD_PAGES_MAX)
+    {
+      list_push_front (&free_thread_pages, &t->elem);
+      free_thread_page_cnt++;
+    }
+  else
+    palloc_free_page (t);
+}
+
 /* Schedules a new process.  At entry, interrupts must be off and
    the running process's state must have been changed from
    running to some other state.  This function finds another
@@ -566,13 +759,22 @@ schedule (void)
   struct thread *curr = running_thread ();
   struct thread *next = next_thread_to_run ();
   struct thread *prev = NULL;
+  bool preempted;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (curr->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  preempted = slice_expired;
+  slice_expired = false;
   if (curr != next)
-    prev = switch_threads (curr, next);
+    {
+      if (curr->status == THREAD_READY && preempted)
+        curr->involuntary_switches++;
+      else if (curr->status != THREAD_DYING)
+        curr->voluntary_switches++;
+      prev = switch_threads (curr, next);
+    }
   schedule_tail (prev);
 }
 
@@ -2,8 +2,12 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include <diskstat.h>
+#include <faultstat.h>
+#include <procstat.h>
 #include "synch.h"   //semaphore
 
 extern struct semaphore file_sema;
@@ -11,10 +15,10 @@ extern struct semaphore file_sema;
 /* States in a thread's life cycle. */
 enum thread_status
   {
-    THREAD_RUNNING,     /* Running thread. */
-    THREAD_READY,       /* Not running but ready to run. */
-    THREAD_BLOCKED,     /* Waiting for an event to trigger. */
-    THREAD_DYING        /* About to be destroyed. */
+    THREAD_RUNNING = PROCSTAT_RUNNING, /* Running thread. */
+    THREAD_READY = PROCSTAT_READY,     /* Not running but ready to run. */
+    THREAD_BLOCKED = PROCSTAT_BLOCKED, /* Waiting for an event to trigger. */
+    THREAD_DYING = PROCSTAT_DYING      /* About to be destroyed. */
   };
 
 
@@ -28,6 +32,9 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Size of a process's file descriptor table. */
+#define FD_MAX 128
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -92,29 +99,60 @@ struct thread
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
+    struct list_elem allelem;           /* List element for all threads list. */
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Scheduling accounting, owned by thread.c.
+       WAIT_REASON is set by whoever is about to block us. */
+    enum wait_reason wait_reason;       /* Why we are (or will be) blocked. */
+    int64_t state_since;                /* Tick we entered current state. */
+    int64_t wakeup_tick;                /* Tick to wake up from sleep. */
+    int64_t run_ticks;                  /* Ticks spent running. */
+    int64_t ready_ticks;                /* Ticks spent on the ready queue. */
+    int64_t blocked_ticks[WAIT_REASON_CNT]; /* Ticks blocked, by reason. */
+    unsigned voluntary_switches;        /* Blocked or yielded the CPU. */
+    unsigned involuntary_switches;      /* Preempted by the timer. */
+
+    /* Owned by devices/disk.c; see disk_set_tag(). */
+    enum disk_tag disk_tag;             /* What our disk I/O is for. */
+
+    /* Owned by filesys/journal.c. */
+    int journal_depth;                  /* Nested journal_begin()s. */
+
 
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
-    struct semaphore child_lock;        /* Sema for child waiting. */
-    // struct semaphore load_lock;          /* Sema for load lock. */
-    struct semaphore memory_lock;        /* Sema for memory - pass when child die - lock. */
-    struct semaphore load_suc_lock;      /* Sema for load success lock. */
-    struct semaphore wait_lock;          /* Sema - wait for wait. */
-
-    struct semaphore child_exit_lock;
-    struct semaphore exit_status_lock;
-    struct semaphore load_lock;
-
-    bool wait;
-    bool success;
-    struct list child_list;             /* List of child. */
-    struct list_elem child_elem;        /* children list element. */
+    struct child_status *child_status;  /* Shared with parent, or null. */
+    struct list children;               /* Our children's child_status. */
     int exit_status;
-    struct file* f_d[128];               /* File descriptor. */
+    struct file **f_d;                  /* File descriptors, FD_MAX entries,
+                                           allocated on first open. */
+
+    /* Owned by userprog/exception.c. */
+    unsigned long long fault_cnt[FAULT_TYPE_CNT]; /* Page faults, by type. */
+#ifdef VM
+    struct file *exec_file;             /* Executable, kept open for paging. */
+
+    /* Owned by vm/page.c. */
+    struct hash pages;                  /* Supplemental page table. */
+    unsigned zero_page_hits;            /* Reads served by the zero page. */
+
+    /* Owned by userprog/syscall.c. */
+    void *user_esp;                     /* User stack pointer on entry
+                                           to a system call. */
+
+    /* Owned by vm/mmap.c. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Next mapping identifier. */
+
+    /* Owned by vm/wss.c. */
+    unsigned wss;                       /* Working set estimate, pages. */
+    unsigned rss;                       /* Resident pages at last scan. */
+    unsigned wss_count;                 /* WSS being counted by a scan. */
+    unsigned rss_count;                 /* RSS being counted by a scan. */
+#endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -138,6 +176,13 @@ tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+void thread_sleep (int64_t wakeup_tick);
+void thread_wakeup (int64_t now);
+int thread_get_stats (struct procstat *, int max);
+
+/* Performs some operation on thread T, given auxiliary data AUX. */
+typedef void thread_action_func (struct thread *t, void *aux);
+void thread_foreach (thread_action_func *, void *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
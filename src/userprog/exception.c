@@ -1,15 +1,28 @@
 #include "userprog/exception.h"
+#include <faultstat.h>
 #include <inttypes.h>
+#include <stdint.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
 #include "userprog/syscall.h" /* new */
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Page faults by how they were resolved, and a histogram of how
+   many CPU cycles each kind took.  See lib/faultstat.h. */
+static unsigned long long fault_cnt[FAULT_TYPE_CNT];
+static unsigned long long fault_hist[FAULT_TYPE_CNT][FAULT_HIST_CNT];
+
+static const char *fault_names[FAULT_TYPE_CNT] =
+  {"file", "swap", "zero", "cow", "stack", "invalid"};
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -66,7 +79,68 @@ exception_init (void)
 void
 exception_print_stats (void) 
 {
+  int type, i;
+
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+  for (type = 0; type < FAULT_TYPE_CNT; type++)
+    {
+      if (fault_cnt[type] == 0)
+        continue;
+      printf ("  %-7s %8llu faults, cycles:", fault_names[type],
+              fault_cnt[type]);
+      for (i = 0; i < FAULT_HIST_CNT; i++)
+        if (fault_hist[type][i] != 0)
+          printf (" 2^%d:%llu", i, fault_hist[type][i]);
+      printf ("\n");
+    }
+}
+
+/* Copies the page fault statistics into *FS, with the per-process
+   counts taken from the running thread.  Interrupts are off
+   throughout, so FS must be kernel memory that cannot fault. */
+void
+exception_get_faultstat (struct faultstat *fs)
+{
+  enum intr_level old_level;
+  int type, i;
+
+  old_level = intr_disable ();
+  for (type = 0; type < FAULT_TYPE_CNT; type++)
+    {
+      fs->total[type] = fault_cnt[type];
+      fs->process[type] = thread_current ()->fault_cnt[type];
+      for (i = 0; i < FAULT_HIST_CNT; i++)
+        fs->hist[type][i] = fault_hist[type][i];
+    }
+  intr_set_level (old_level);
+}
+
+/* Returns the CPU's time-stamp counter, which counts cycles. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Counts a page fault of the given TYPE that started at time
+   stamp START. */
+static void
+fault_account (enum fault_type type, uint64_t start)
+{
+  uint64_t cycles = rdtsc () - start;
+  enum intr_level old_level;
+  int bucket = 0;
+
+  while (bucket < FAULT_HIST_CNT - 1 && cycles >> (bucket + 1) != 0)
+    bucket++;
+
+  old_level = intr_disable ();
+  fault_cnt[type]++;
+  fault_hist[type][bucket]++;
+  thread_current ()->fault_cnt[type]++;
+  intr_set_level (old_level);
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -110,9 +184,9 @@ kill (struct intr_frame *f)
     }
 }
 
-/* Page fault handler.  This is a skeleton that must be filled in
-   to implement virtual memory.  Some solutions to project 2 may
-   also require modifying this code.
+/* Page fault handler.  With virtual memory, brings in the page
+   that was touched, grows the stack, or breaks copy-on-write
+   sharing.  Any other fault kills the process with exit code -1.
 
    At entry, the address that faulted is in CR2 (Control Register
    2) and information about the fault, formatted as described in
@@ -122,12 +196,16 @@ kill (struct intr_frame *f)
    description of "Interrupt 14--Page Fault Exception (#PF)" in
    [IA32-v3a] section 5.15 "Exception and Interrupt Reference". */
 static void
-page_fault (struct intr_frame *f) 
+page_fault (struct intr_frame *f UNUSED)
 {
+  void *fault_addr;  /* Fault address. */
+  uint64_t start = rdtsc ();
+#ifdef VM
   bool not_present;  /* True: not-present page, false: writing r/o page. */
   bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
-  void *fault_addr;  /* Fault address. */
+  enum fault_type type;
+#endif
 
   /* Obtain faulting address, the virtual address that was
      accessed to cause the fault.  It may point to code or to
@@ -145,34 +223,40 @@ page_fault (struct intr_frame *f)
   /* Count page faults. */
   page_fault_cnt++;
 
+#ifdef VM
   /* Determine cause. */
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  if(!user || is_kernel_vaddr(fault_addr) || not_present)
-  {
-     userp_exit(-1);
-      // printf("%s: exit(%d)\n", thread_name(), -1);
-      // thread_exit();
-      
-  } //bad-jump2
-  
-   if(!user) //kernel
-   {
-      f->eip = (void *)f->eax;
-      f->eax = 0xffffffff; //FIXME: not sure
-      return; //??
-   }
-
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
-  printf ("Page fault at %p: %s error %s page in %s context.\n",
-          fault_addr,
-          not_present ? "not present" : "rights violation",
-          write ? "writing" : "reading",
-          user ? "user" : "kernel");
-  kill (f);
+  /* Bring in a page of the address space on first touch, whether
+     the process itself or the kernel on its behalf touched it,
+     or grow the stack to cover it.  A fault in the kernel comes
+     from a system call, so use the stack pointer saved on entry
+     to it.  A write to a present page may be to one shared
+     copy-on-write since fork(), or to the shared zero page. */
+  type = FAULT_INVALID;
+  if (not_present)
+    {
+      type = page_load (fault_addr, write);
+      if (type == FAULT_INVALID
+          && page_grow_stack (fault_addr,
+                              user ? f->esp : thread_current ()->user_esp))
+        type = FAULT_STACK;
+    }
+  else if (write)
+    type = page_unshare (fault_addr);
+  if (type != FAULT_INVALID)
+    {
+      fault_account (type, start);
+      return;
+    }
+#endif
+  fault_account (FAULT_INVALID, start);
+
+  /* Nothing may be mapped here: an unmapped or kernel address, a
+     write to read-only memory, or a bad pointer passed to a
+     system call.  Either way the process dies. */
+  userp_exit (-1);
 }
 
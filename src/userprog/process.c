@@ -15,13 +15,111 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/wss.h"
+#endif
 
 static thread_func start_process NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
+/* Child status records of all live processes' children, keyed
+   by child tid, so that process_wait() need not search. */
+static struct hash child_table;
+static struct lock child_table_lock;
+
+static unsigned
+child_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct child_status *cs = hash_entry (e, struct child_status,
+                                              hash_elem);
+  return hash_int (cs->tid);
+}
+
+static bool
+child_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct child_status *a = hash_entry (a_, struct child_status,
+                                             hash_elem);
+  const struct child_status *b = hash_entry (b_, struct child_status,
+                                             hash_elem);
+  return a->tid < b->tid;
+}
+
+/* Initializes the child table. */
+void
+process_init (void)
+{
+  hash_init (&child_table, child_hash, child_less, NULL);
+  lock_init_named (&child_table_lock, "child_table");
+}
+
+/* Drops a reference to CS, freeing it if it was the last. */
+static void
+child_status_put (struct child_status *cs)
+{
+  bool last;
+
+  lock_acquire (&child_table_lock);
+  last = --cs->ref_cnt == 0;
+  lock_release (&child_table_lock);
+  if (last)
+    free (cs);
+}
+
+/* Detaches CS from its parent, which must be the running thread,
+   and drops the parent's reference to it. */
+static void
+child_status_detach (struct child_status *cs)
+{
+  lock_acquire (&child_table_lock);
+  hash_delete (&child_table, &cs->hash_elem);
+  list_remove (&cs->elem);
+  lock_release (&child_table_lock);
+  child_status_put (cs);
+}
+
+/* Initializes CS for a child of the running thread that is about
+   to be created, with command line CMD_LINE. */
+static void
+child_status_init (struct child_status *cs, char *cmd_line)
+{
+  cs->parent_tid = thread_current ()->tid;
+  cs->cmd_line = cmd_line;
+  sema_init (&cs->loaded, 0);
+  cs->load_success = false;
+  sema_init (&cs->exited, 0);
+  cs->exit_status = -1;
+  cs->ref_cnt = 2;
+}
+
+/* Records CS as the running thread's child TID and waits for the
+   child to load.  Returns TID if the child loaded successfully,
+   otherwise TID_ERROR. */
+static tid_t
+child_status_attach (struct child_status *cs, tid_t tid)
+{
+  cs->tid = tid;
+  lock_acquire (&child_table_lock);
+  hash_insert (&child_table, &cs->hash_elem);
+  list_push_back (&thread_current ()->children, &cs->elem);
+  lock_release (&child_table_lock);
+
+  sema_down (&cs->loaded);
+  if (!cs->load_success)
+    {
+      child_status_detach (cs);
+      return TID_ERROR;
+    }
+  return tid;
+}
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -30,12 +128,9 @@ tid_t
 process_execute (const char *cmd)
 {
   char *fn_copy, *cmd_copy;
-  tid_t tid; //  ls -al
-  struct thread* t, *t1;
-  struct list_elem* e;
-
-  char *file_name; //only name of the smd (1st word)
- // printf("cmd: %s\n",cmd);    //for debugging
+  char *file_name, *save_ptr; //only name of the cmd (1st word)
+  struct child_status *cs;
+  tid_t tid;
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
@@ -44,78 +139,48 @@ process_execute (const char *cmd)
     return TID_ERROR;
   strlcpy (fn_copy, cmd, PGSIZE);
 
+  /* Thread name is the first word of CMD. */
   cmd_copy = palloc_get_page (0);
-  if (cmd_copy == NULL)
-    return TID_ERROR;
+  cs = malloc (sizeof *cs);
+  if (cmd_copy == NULL || cs == NULL)
+    goto error;
   strlcpy (cmd_copy, cmd, PGSIZE);
-
-  /* Tokenize(Parse) cmd. */
-  char *tokens[30] = {NULL,};
-  char *token, *save_ptr;
-  int i = 0;
-  for (token = strtok_r (cmd_copy, " ", &save_ptr); token != NULL;
-    token = strtok_r (NULL, " ", &save_ptr)){
-      tokens[i] = token;
-      i++;
-    }
-  file_name = tokens[0];
+  file_name = strtok_r (cmd_copy, " ", &save_ptr);
 
   /* Invalid name => return tid = -1 */
-  if(file_name == NULL)  //|| filesys_open(file_name) == NULL
-  {
-    palloc_free_page (fn_copy);
-    palloc_free_page (cmd_copy);
-    return -1;
-  }
-
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy); //child
+  if (file_name == NULL)
+    goto error;
 
-  if(!list_empty(&(thread_current()->child_list)))
-  {
-    for(e = list_begin(&(thread_current()->child_list)); e != list_end(&(thread_current()->child_list)); e = list_next(e))
-    {
-      t = list_entry(e, struct thread, child_elem);
-      if(tid == t->tid)   //child list 순회 돌려서 보고있는 자식이면 wait 걸기
-      {
-        t1 = t;
-      }
-    }
-  }
+  child_status_init (cs, fn_copy);
 
-  if(!t1)
-  {
-    palloc_free_page (fn_copy);
-    palloc_free_page (cmd_copy);
-    return -1;
-  }
-  //after chile created..
-  sema_down(&(t1->load_lock));
-  // sema_down(&(t1->child_exit_lock));
+#ifdef VM
+  /* Don't start another process while memory is overcommitted. */
+  wss_admit ();
+#endif
 
+  /* Create a new thread to execute FILE_NAME. */
+  tid = thread_create (file_name, PRI_DEFAULT, start_process, cs); //child
   if (tid == TID_ERROR)
-  {
-    palloc_free_page (fn_copy);
-    palloc_free_page (cmd_copy);
-  }
+    goto error;
+  palloc_free_page (cmd_copy);
 
+  /* Wait for the child to load, so that a bad executable gives -1. */
+  return child_status_attach (cs, tid);
 
-  bool temp = t1->success;
-  // sema_up(&t1->load_suc_lock);  //TODO:
-  if(temp)
-  {
-    palloc_free_page (cmd_copy);
-    return tid;
-  }
-  return -1;
+ error:
+  palloc_free_page (fn_copy);
+  palloc_free_page (cmd_copy);
+  free (cs);
+  return TID_ERROR;
 }
 
 /* A thread function that loads a user process and makes it start
    running. */
 static void
-start_process (void *cmd)
+start_process (void *cs_)
 {
-
+  struct child_status *cs = cs_;
+  char *cmd = cs->cmd_line;
   char *file_name;
   struct intr_frame if_;
   bool success;
@@ -137,13 +202,15 @@ start_process (void *cmd)
       i++;
     }
   file_name = tokens[0];
+  thread_current ()->child_status = cs;
+  thread_current ()->exit_status = -1;  /* Until exit() says otherwise. */
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
   success = load (file_name, &if_.eip, &if_.esp);
-  thread_current()->success = success;
   esp = if_.esp;
   // printf("esp: %x\n", esp);    //for debugging
   //dump(esp, esp, 200, true);    //for debugging
@@ -199,9 +266,9 @@ start_process (void *cmd)
 
   palloc_free_page (file_name);  //free fn_copy
 
-  /* Prevent parent do something during child creating. */
-  sema_up(&(thread_current()->load_lock));  //thread_current() = child => lock parent
-  // sema_down(&(thread_current()->load_suc_lock)); //TODO:
+  /* Let the parent return from exec(). */
+  cs->load_success = success;
+  sema_up (&cs->loaded);
 
 
   /* If load failed, quit. */
@@ -220,6 +287,123 @@ start_process (void *cmd)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/* Passed from process_fork() to the child. */
+struct fork_info
+  {
+    struct child_status *cs;    /* Child's status record. */
+    struct thread *parent;      /* Forking process. */
+    struct intr_frame if_;      /* Parent's user context. */
+  };
+
+static thread_func fork_process NO_RETURN;
+static bool fork_files (struct thread *parent);
+
+/* Starts a new process that is a copy of the running one,
+   resuming from the user context F.  The parent's resident
+   memory is shared with the child copy-on-write, and the child
+   shares the parent's open files.  Returns the child's thread id
+   in the parent, or TID_ERROR if it cannot be created; the child
+   returns 0. */
+tid_t
+process_fork (const struct intr_frame *f)
+{
+  struct fork_info *fi;
+  struct child_status *cs;
+  tid_t tid;
+
+  fi = malloc (sizeof *fi);
+  cs = malloc (sizeof *cs);
+  if (fi == NULL || cs == NULL)
+    {
+      free (fi);
+      free (cs);
+      return TID_ERROR;
+    }
+  child_status_init (cs, NULL);
+  fi->cs = cs;
+  fi->parent = thread_current ();
+  fi->if_ = *f;
+
+  tid = thread_create (thread_name (), PRI_DEFAULT, fork_process, fi);
+  if (tid == TID_ERROR)
+    {
+      free (fi);
+      free (cs);
+      return TID_ERROR;
+    }
+
+  /* We stay blocked until the child has copied our address space
+     and files, so that they hold still while it does. */
+  tid = child_status_attach (cs, tid);
+  free (fi);
+  return tid;
+}
+
+/* A thread function that copies the forking process and makes
+   the copy start running. */
+static void
+fork_process (void *fi_)
+{
+  struct fork_info *fi = fi_;
+  struct thread *t = thread_current ();
+  struct thread *parent = fi->parent;
+  struct child_status *cs = fi->cs;
+  struct intr_frame if_ = fi->if_;
+  bool success = false;
+
+  t->child_status = cs;
+  t->exit_status = -1;
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir != NULL)
+    {
+      process_activate ();
+      sema_down(&file_sema);
+      t->exec_file = file_reopen (parent->exec_file);
+      if (t->exec_file != NULL)
+        file_deny_write (t->exec_file);
+      sema_up(&file_sema);
+      success = (t->exec_file != NULL && page_table_init ()
+                 && page_table_copy (parent) && fork_files (parent));
+    }
+
+  /* Let the parent return from fork(). */
+  cs->load_success = success;
+  sema_up (&cs->loaded);
+
+  if (!success)
+    userp_exit(-1);
+
+  /* The child sees fork() return 0. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Gives the running thread references to each of PARENT's open
+   files.  Returns true if successful, false if memory is
+   short. */
+static bool
+fork_files (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  int fd;
+
+  if (parent->f_d == NULL)
+    return true;
+  t->f_d = calloc (FD_MAX, sizeof *t->f_d);
+  if (t->f_d == NULL)
+    return false;
+  sema_down(&file_sema);
+  for (fd = 0; fd < FD_MAX; fd++)
+    if (parent->f_d[fd] != NULL)
+      t->f_d[fd] = file_dup (parent->f_d[fd]);
+  sema_up(&file_sema);
+  return true;
+}
+#endif /* VM */
+
 /* This is 2016 spring cs330 skeleton code */
 
 /* Waits for thread TID to die and returns its exit status.  If
@@ -232,37 +416,28 @@ start_process (void *cmd)
    This function will be implemented in problem 2-2.  For now, it
    does nothing. */
 int
-process_wait (tid_t child_tid UNUSED)
+process_wait (tid_t child_tid)
 {
-  struct list_elem* e;
-  struct thread* t = NULL, *t1 = NULL;
+  struct child_status key, *cs = NULL;
+  struct hash_elem *e;
   int exit_status;
 
-  for(e = list_begin(&(thread_current()->child_list)); e != list_end(&(thread_current()->child_list)); e = list_next(e))
-  {
-    t = list_entry(e, struct thread, child_elem);
-    if(child_tid == t->tid)   //child list 순회 돌려서 보고있는 자식이면 wait 걸기
+  key.tid = child_tid;
+  lock_acquire (&child_table_lock);
+  e = hash_find (&child_table, &key.hash_elem);
+  if (e != NULL)
     {
-      t1 = t;
+      cs = hash_entry (e, struct child_status, hash_elem);
+      if (cs->parent_tid != thread_current ()->tid)
+        cs = NULL;
     }
-  }
-  if(t1 == NULL)
-  {
+  lock_release (&child_table_lock);
+  if (cs == NULL)
     return -1;
-  }
-  t1->wait = true;
-  // sema_up(&t->wait_lock); //wait lock release
-
-  // sema_down(&(t->child_lock));  //child 있으면 lock 걸기
-  sema_down(&(t1->child_exit_lock));
-  exit_status = t1->exit_status;
-  list_remove(&(t1->child_elem));
-  // printf("**** tid:%d, namd: %s\n", t1->tid, t1->name);
-  sema_up(&(t1->exit_status_lock));
-
-  // sema_up(&(t->memory_lock));   //release
-  // sema_up(&t->wait_lock);
-  //t->wait = false;
+
+  sema_down (&cs->exited);
+  exit_status = cs->exit_status;
+  child_status_detach (cs);
   return exit_status;
 }
 
@@ -277,11 +452,27 @@ process_exit (void)
   /*Bye~dir*/
   dir_close(curr->dir);
 
+  /* Files were closed by userp_exit(); drop the fd table. */
+  free(curr->f_d);
+  curr->f_d = NULL;
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = curr->pagedir;
   if (pd != NULL)
     {
+#ifdef VM
+      mmap_unmap_all ();
+      page_table_destroy ();
+      if (curr->exec_file != NULL)
+        {
+          sema_down(&file_sema);
+          file_close (curr->exec_file);
+          sema_up(&file_sema);
+          curr->exec_file = NULL;
+        }
+#endif
+
       /* Correct ordering here is crucial.  We must set
          cur->pagedir to NULL before switching page directories,
          so that a timer interrupt can't switch back to the
@@ -294,25 +485,22 @@ process_exit (void)
       pagedir_destroy (pd);
     }
 
-  sema_up(&(curr->child_exit_lock));
-
-  sema_down(&(curr->exit_status_lock));
-
-  // if(curr->wait)
-  // {
-  //   sema_up(&(curr->child_lock));
-  //   sema_down(&(curr->memory_lock));  //lock parent until child pass mem
-  // }
-  /* if wait = false, wait until parent wait(child=curr). */
-
-  // sema_down(&curr->wait_lock);  //wait until parent wait
-
-  // sema_up(&(curr->child_lock));
-  // sema_down(&(curr->memory_lock));  //lock parent until child pass mem
-
-  // sema_down(&curr->wait_lock);
-
+  /* Give up our children's records; those still running free
+     theirs when they exit. */
+  while (!list_empty (&curr->children))
+    child_status_detach (list_entry (list_front (&curr->children),
+                                     struct child_status, elem));
 
+  /* Report our exit status to our parent, if any.  Nothing else
+     refers to this thread afterward, so it can be destroyed right
+     away. */
+  if (curr->child_status != NULL)
+    {
+      curr->child_status->exit_status = curr->exit_status;
+      sema_up (&curr->child_status->exited);
+      child_status_put (curr->child_status);
+      curr->child_status = NULL;
+    }
 }
 
 /* Sets up the CPU for running user code in the current
@@ -419,6 +607,10 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (t->pagedir == NULL)
     goto done;  //success = false
   process_activate ();
+#ifdef VM
+  if (!page_table_init ())
+    goto done;
+#endif
 
   /* Open executable file. */
   sema_down(&file_sema);
@@ -430,6 +622,14 @@ load (const char *file_name, void (**eip) (void), void **esp)
       printf ("load: %s: open failed\n", file_name);
       goto done;  //seuccess = false
     }
+#ifdef VM
+  /* Pages are read from the executable on demand, so keep it
+     open, and unchanged, until we exit. */
+  t->exec_file = file;
+  sema_down(&file_sema);
+  file_deny_write (file);
+  sema_up(&file_sema);
+#endif
 
   /* Read and verify executable header. */
   sema_down(&file_sema);
@@ -528,7 +728,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+#ifndef VM
   if(file != NULL)
+#else
+  if(file != NULL && file != t->exec_file)
+#endif
   {
     sema_down(&file_sema);
     file_close(file);
@@ -545,7 +749,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -617,6 +823,24 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifdef VM
+  /* Just record where each page comes from; page_load() reads it
+     in on first touch. */
+  while (read_bytes > 0 || zero_bytes > 0)
+    {
+      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+      size_t page_zero_bytes = PGSIZE - page_read_bytes;
+
+      if (!page_add_file (upage, file, ofs, page_read_bytes, writable))
+        return false;
+
+      read_bytes -= page_read_bytes;
+      zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
+      upage += PGSIZE;
+    }
+  return true;
+#else
   sema_down(&file_sema);
   file_seek (file, ofs);
   sema_up(&file_sema);
@@ -657,6 +881,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       upage += PGSIZE;
     }
   return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
@@ -664,6 +889,16 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp)
 {
+#ifdef VM
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+  if (page_add_zero (upage, true)
+      && page_load (upage, true) != FAULT_INVALID)
+    {
+      *esp = PHYS_BASE;
+      return true;
+    }
+  return false;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -679,8 +914,10 @@ setup_stack (void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -700,3 +937,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
@@ -1,9 +1,37 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <hash.h>
+#include <list.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
 
+/* Exit status of a child process, shared by the parent and the
+   child.  Allocated by the parent in process_execute() or
+   process_fork() and freed when both sides are done with it, so
+   that a child can be torn down as soon as it exits whether or
+   not its parent ever waits for it, and a parent may exit
+   without waiting. */
+struct child_status
+  {
+    tid_t tid;                  /* Child's thread id. */
+    tid_t parent_tid;           /* Parent's thread id. */
+    struct hash_elem hash_elem; /* Element in child table, by tid. */
+    struct list_elem elem;      /* Element in parent's `children'. */
+    char *cmd_line;             /* Command line, until loaded. */
+    struct semaphore loaded;    /* Upped when load finishes. */
+    bool load_success;          /* Did load succeed? */
+    struct semaphore exited;    /* Upped when child exits. */
+    int exit_status;            /* Child's exit status. */
+    int ref_cnt;                /* 2 = both alive, 1 = one, 0 = free. */
+  };
+
+void process_init (void);
 tid_t process_execute (const char *file_name);
+#ifdef VM
+struct intr_frame;
+tid_t process_fork (const struct intr_frame *);
+#endif
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
@@ -1,13 +1,37 @@
 #include "userprog/syscall.h"
+#include <diskstat.h>
+#include <faultstat.h>
+#include <memstat.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "devices/disk.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"  //->file_sema
 #include "threads/vaddr.h"
+#include "userprog/exception.h"
 #include "userprog/pagedir.h"
+#include "userprog/process.h"
 #include "filesys/off_t.h"  /* new */
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/mmap.h"
+#include "vm/page.h"
+#include "vm/wss.h"
+#endif
+
+/* Most thread snapshots a single procstat() call returns. */
+#define PROCSTAT_MAX 64
+
+/* Most process estimates a single wssstat() call returns. */
+#define WSSSTAT_MAX 64
+
+/* Most trace entries a single disktrace() call returns. */
+#define DISKTRACE_MAX 256
 
 static void syscall_handler (struct intr_frame *);
 void userp_exit (int status);
@@ -17,6 +41,7 @@ struct file
     struct inode *inode;        /* File's inode. */
     off_t pos;                  /* Current position. */
     bool deny_write;            /* Has file_deny_write() been called? */
+    int ref_cnt;                /* Number of references, from file_dup(). */
   };
   // ctrl c+v from filesys/file.c
 
@@ -48,6 +73,18 @@ put_user (uint8_t *udst, uint8_t byte)
   return error_code != -1;
 }
 
+/* Returns the file open as FD in the current process, or a null
+   pointer if there is none.  The fd table is allocated on the
+   first open(), so it may not exist yet. */
+static struct file *
+fd_get (int fd)
+{
+  struct thread *t = thread_current();
+  if(fd < 0 || fd >= FD_MAX || t->f_d == NULL)
+    return NULL;
+  return t->f_d[fd];
+}
+
 void check_valid_pointer(const void *vaddr)
 {
   if(!is_user_vaddr(vaddr))
@@ -73,6 +110,9 @@ syscall_handler (struct intr_frame *f)
 
   //sc-bad-sp
   check_valid_pointer(f->esp);
+#ifdef VM
+  thread_current()->user_esp = f->esp;
+#endif
   if(get_user((uint8_t *)f->esp) == -1)
   {
     userp_exit(-1);
@@ -196,16 +236,28 @@ syscall_handler (struct intr_frame *f)
         }
         sema_up(&file_sema);
 
-        for(i = 3; i < 128; ++i)
+        struct thread *t = thread_current();
+        if(t->f_d == NULL)  //first open: allocate fd table
+          t->f_d = calloc(FD_MAX, sizeof *t->f_d);
+        if(t->f_d != NULL)
         {
-          if(thread_current()->f_d[i] == NULL)
+          for(i = 3; i < FD_MAX; ++i)
           {
+            if(t->f_d[i] == NULL)
+            {
 
-            thread_current()->f_d[i] = fp;
-            f->eax = i;
-            break;  //end for loop
+              t->f_d[i] = fp;
+              f->eax = i;
+              break;  //end for loop
+            }
           }
         }
+        if((int)f->eax == -1)  //no free fd
+        {
+          sema_down(&file_sema);
+          file_close(fp);
+          sema_up(&file_sema);
+        }
       }
 
       break;  //end open
@@ -214,7 +266,7 @@ syscall_handler (struct intr_frame *f)
     //syscall1 (SYS_FILESIZE, fd);
     case SYS_FILESIZE: //7
     {
-      if(thread_current()->f_d[first] == NULL)
+      if(fd_get(first) == NULL)
       {
         userp_exit(-1);
       }
@@ -224,7 +276,7 @@ syscall_handler (struct intr_frame *f)
       // }
       check_valid_pointer((f->esp) + 4); //fd = first
       sema_down(&file_sema);
-      f->eax = file_length(thread_current()->f_d[first]);
+      f->eax = file_length(fd_get(first));
       sema_up(&file_sema);
       break;
     }
@@ -259,7 +311,7 @@ syscall_handler (struct intr_frame *f)
       }
       else if(first > 2)  //not stdin
       {
-        if(thread_current()->f_d[first] == NULL)
+        if(fd_get(first) == NULL)
         {
           userp_exit(-1);
         }
@@ -267,10 +319,23 @@ syscall_handler (struct intr_frame *f)
         {
           userp_exit(-1);
         }
+#ifdef VM
+        /* The file system copies into the buffer while holding
+           locks that faulting in a page would need, so keep it
+           resident until the read is done. */
+        if(!page_pin(second, third, true))
+        {
+          page_unpin(second, third);
+          userp_exit(-1);
+        }
+#endif
 
         sema_down(&file_sema);
-        f->eax = file_read(thread_current()->f_d[first], second, third);
+        f->eax = file_read(fd_get(first), second, third);
         sema_up(&file_sema);
+#ifdef VM
+        page_unpin(second, third);
+#endif
         break; //end read
       }
       f->eax = i;
@@ -303,20 +368,30 @@ syscall_handler (struct intr_frame *f)
       }
       else if(fd > 2)  //not stdout
       {
-        if(thread_current()->f_d[fd] == NULL)
+        if(fd_get(fd) == NULL)
         {
           userp_exit(-1);
         }
-        if(thread_current()->f_d[fd]->deny_write)  //FIXME: rox check
+        if(fd_get(fd)->deny_write)  //FIXME: rox check
         {
           sema_down(&file_sema);
-          file_deny_write(thread_current()->f_d[fd]);
+          file_deny_write(fd_get(fd));
           sema_up(&file_sema);
         }
+#ifdef VM
+        if(!page_pin(second, third, false))
+        {
+          page_unpin(second, third);
+          userp_exit(-1);
+        }
+#endif
 
         sema_down(&file_sema);
-        f->eax = file_write(thread_current()->f_d[fd], second, third);
+        f->eax = file_write(fd_get(fd), second, third);
         sema_up(&file_sema);
+#ifdef VM
+        page_unpin(second, third);
+#endif
         break;  //end write
       }
       f->eax = -1;
@@ -327,7 +402,7 @@ syscall_handler (struct intr_frame *f)
     case SYS_SEEK: //10
     {
       int fd = first;
-      if(thread_current()->f_d[fd] == NULL)
+      if(fd_get(fd) == NULL)
       {
         userp_exit(-1);
       }
@@ -336,7 +411,7 @@ syscall_handler (struct intr_frame *f)
       check_valid_pointer(second); //also a pointer
 
       sema_down(&file_sema);
-      file_seek(thread_current()->f_d[fd], (unsigned)second);
+      file_seek(fd_get(fd), (unsigned)second);
       sema_up(&file_sema);
       break;
     }
@@ -345,14 +420,14 @@ syscall_handler (struct intr_frame *f)
     case SYS_TELL: //11
     {
       int fd = first;
-      if(thread_current()->f_d[fd] == NULL)
+      if(fd_get(fd) == NULL)
       {
         userp_exit(-1);
       }
       check_valid_pointer((f->esp) + 4); //fd = first
 
       sema_down(&file_sema);
-      file_tell(thread_current()->f_d[fd]);
+      file_tell(fd_get(fd));
       sema_up(&file_sema);
       break;
     }
@@ -361,22 +436,46 @@ syscall_handler (struct intr_frame *f)
     case SYS_CLOSE: //12
     {
       int fd = first;
-      if(thread_current()->f_d[fd] == NULL)
+      if(fd_get(fd) == NULL)
       {
         userp_exit(-1);
       }
       check_valid_pointer((f->esp) + 4); //fd = first
 
+      /* file_close() re-allows writes once the last reference
+         goes, which may be held by a forked child or parent. */
       sema_down(&file_sema);
-      file_allow_write(thread_current()->f_d[fd]);
-      file_close(thread_current()->f_d[fd]);
-      // file_allow_write(thread_current()->f_d[fd]);  //FIXME: it occurs error ... wrong position?
+      file_close(fd_get(fd));
       sema_up(&file_sema);
 
       thread_current()->f_d[fd] = NULL;  //file closed -> make it NULL
       break;
     }
 
+#ifdef VM
+    //syscall2 (SYS_MMAP, fd, addr);
+    case SYS_MMAP: //13
+    {
+      check_valid_pointer((f->esp) + 4); //fd = first
+      check_valid_pointer((f->esp) + 8); //addr = second
+      if(fd_get(first) == NULL)
+      {
+        f->eax = MAP_FAILED;
+        break;
+      }
+      f->eax = mmap_map(fd_get(first), second);
+      break;
+    }
+
+    //syscall1 (SYS_MUNMAP, mapid);
+    case SYS_MUNMAP: //14
+    {
+      check_valid_pointer((f->esp) + 4); //mapid = first
+      mmap_unmap(first);
+      break;
+    }
+#endif
+
     //syscall1 (SYS_CHDIR, dir)
     case SYS_CHDIR: //15
     {
@@ -437,7 +536,7 @@ syscall_handler (struct intr_frame *f)
       check_valid_pointer((f->esp) + 4); //fd = first
       check_valid_pointer((f->esp) + 8); //buffer = second
       bool success = true;
-      struct file *fp = thread_current()->f_d[first];
+      struct file *fp = fd_get(first);
       bool inode_dir;
       struct inode_disk *disk_inode = NULL;
       disk_inode = calloc(1, sizeof *disk_inode);
@@ -467,7 +566,7 @@ syscall_handler (struct intr_frame *f)
     // syscall1 (SYS_ISDIR, fd)
     case SYS_ISDIR: //18
     {
-      struct file *fp = thread_current()->f_d[first];
+      struct file *fp = fd_get(first);
       bool inode_dir;
       struct inode_disk *disk_inode = NULL;
       disk_inode = calloc(1, sizeof *disk_inode);
@@ -491,7 +590,7 @@ syscall_handler (struct intr_frame *f)
     //syscall1 (SYS_INUMBER, fd)
     case SYS_INUMBER: //19
     {
-      struct file *fp = thread_current()->f_d[first];
+      struct file *fp = fd_get(first);
       if(fp == NULL)
         f->eax = -1;
       else
@@ -499,6 +598,194 @@ syscall_handler (struct intr_frame *f)
 
       break;
     }
+
+    //syscall2 (SYS_PROCSTAT, stats, max)
+    case SYS_PROCSTAT: //20
+    {
+      check_valid_pointer((f->esp) + 4); //stats = first
+      check_valid_pointer((f->esp) + 8); //max = second
+      int max = (int)second;
+      struct procstat *stats;
+
+      if(max > PROCSTAT_MAX)
+        max = PROCSTAT_MAX;
+      if(max <= 0)
+      {
+        f->eax = 0;
+        break;
+      }
+      check_valid_pointer((void *)first);
+      check_valid_pointer((void *)first + max * sizeof *stats - 1);
+
+      /* Snapshot with interrupts off into a kernel buffer, then
+         copy out, so that a fault on the user buffer can't happen
+         while the thread list is frozen. */
+      stats = malloc(max * sizeof *stats);
+      if(stats == NULL)
+      {
+        f->eax = -1;
+        break;
+      }
+      f->eax = thread_get_stats(stats, max);
+      memcpy((void *)first, stats, f->eax * sizeof *stats);
+      free(stats);
+      break;
+    }
+
+    //syscall1 (SYS_MEMSTAT, stats)
+    case SYS_MEMSTAT: //21
+    {
+      check_valid_pointer((f->esp) + 4); //stats = first
+      struct memstat *ms = (struct memstat *)first;
+      size_t used, total;
+
+      check_valid_pointer(ms);
+      check_valid_pointer((void *)(ms + 1) - 1);
+      palloc_get_stats(0, &used, &total);
+      ms->kernel_used = used;
+      ms->kernel_total = total;
+      palloc_get_stats(PAL_USER, &used, &total);
+      ms->user_used = used;
+      ms->user_total = total;
+#ifdef VM
+      ms->zero_page_hits = thread_current()->zero_page_hits;
+      {
+        /* Not straight into MS: a fault there would need the
+           frame table lock. */
+        unsigned pages, mapped, read_bytes;
+        frame_get_cache_stats(&pages, &mapped, &read_bytes);
+        ms->cache_pages = pages;
+        ms->cache_mapped = mapped;
+        ms->cache_read_bytes = read_bytes;
+      }
+#else
+      ms->zero_page_hits = 0;
+      ms->cache_pages = ms->cache_mapped = ms->cache_read_bytes = 0;
+#endif
+      f->eax = true;
+      break;
+    }
+
+    //syscall0 (SYS_FORK);
+    case SYS_FORK: //22
+    {
+#ifdef VM
+      f->eax = process_fork(f);
+#else
+      f->eax = -1;
+#endif
+      break;
+    }
+
+    //syscall1 (SYS_FAULTSTAT, stats)
+    case SYS_FAULTSTAT: //23
+    {
+      check_valid_pointer((f->esp) + 4); //stats = first
+      struct faultstat *fs = (struct faultstat *)first;
+      struct faultstat *snapshot;
+
+      check_valid_pointer(fs);
+      check_valid_pointer((void *)(fs + 1) - 1);
+
+      /* Taken with interrupts off, so not straight into user
+         memory: a fault there would count itself.  Too big for
+         the kernel stack. */
+      snapshot = malloc(sizeof *snapshot);
+      if(snapshot == NULL)
+      {
+        f->eax = false;
+        break;
+      }
+      exception_get_faultstat(snapshot);
+      memcpy(fs, snapshot, sizeof *snapshot);
+      free(snapshot);
+      f->eax = true;
+      break;
+    }
+
+    //syscall2 (SYS_WSSSTAT, stats, max)
+    case SYS_WSSSTAT: //24
+    {
+      check_valid_pointer((f->esp) + 4); //stats = first
+      check_valid_pointer((f->esp) + 8); //max = second
+#ifdef VM
+      int max = (int)second;
+      struct wssstat *stats;
+
+      if(max > WSSSTAT_MAX)
+        max = WSSSTAT_MAX;
+      if(max <= 0)
+      {
+        f->eax = 0;
+        break;
+      }
+      check_valid_pointer((void *)first);
+      check_valid_pointer((void *)first + max * sizeof *stats - 1);
+
+      /* As for procstat(), snapshot first, then copy out. */
+      stats = malloc(max * sizeof *stats);
+      if(stats == NULL)
+      {
+        f->eax = -1;
+        break;
+      }
+      f->eax = wss_get_stats(stats, max);
+      memcpy((void *)first, stats, f->eax * sizeof *stats);
+      free(stats);
+#else
+      f->eax = -1;
+#endif
+      break;
+    }
+
+    //syscall1 (SYS_DISKSTAT, stats)
+    case SYS_DISKSTAT: //25
+    {
+      check_valid_pointer((f->esp) + 4); //stats = first
+      struct diskstat *ds = (struct diskstat *)first;
+      struct diskstat snapshot;
+
+      check_valid_pointer(ds);
+      check_valid_pointer((void *)(ds + 1) - 1);
+
+      /* Taken with interrupts off, so not straight into user
+         memory. */
+      disk_get_stats(&snapshot);
+      memcpy(ds, &snapshot, sizeof snapshot);
+      f->eax = true;
+      break;
+    }
+
+    //syscall2 (SYS_DISKTRACE, trace, max)
+    case SYS_DISKTRACE: //26
+    {
+      check_valid_pointer((f->esp) + 4); //trace = first
+      check_valid_pointer((f->esp) + 8); //max = second
+      int max = (int)second;
+      struct disktrace *trace;
+
+      if(max > DISKTRACE_MAX)
+        max = DISKTRACE_MAX;
+      if(max <= 0)
+      {
+        f->eax = 0;
+        break;
+      }
+      check_valid_pointer((void *)first);
+      check_valid_pointer((void *)first + max * sizeof *trace - 1);
+
+      /* As for procstat(), snapshot first, then copy out. */
+      trace = malloc(max * sizeof *trace);
+      if(trace == NULL)
+      {
+        f->eax = -1;
+        break;
+      }
+      f->eax = disk_get_trace(trace, max);
+      memcpy((void *)first, trace, f->eax * sizeof *trace);
+      free(trace);
+      break;
+    }
   }
 
   //thread_exit ();  //initial
@@ -513,12 +800,12 @@ void userp_exit (int status)  //userprog_exit
 {
   int i;
   thread_current()->exit_status = status;
-  for(i = 3; i < 128; ++i)
+  for(i = 3; i < FD_MAX; ++i)
   {
-    if(thread_current()->f_d[i] != NULL)  //close all files before die
+    if(fd_get(i) != NULL)  //close all files before die
     {
       sema_down(&file_sema);
-      file_close(thread_current()->f_d[i]);
+      file_close(fd_get(i));
       sema_up(&file_sema);
     }
   }
@@ -0,0 +1,890 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/wss.h"
+
+/* Frame table.
+
+   Every frame of the user pool that holds a user page is on
+   frame_list.  When the user pool runs dry, frame_alloc() picks
+   a victim with the clock algorithm, sweeping CLOCK_HAND around
+   the list and giving each recently accessed frame a second
+   chance, and has page_out() move its pages to backing store.
+
+   Eviction works in batches: each sweep of the hand reclaims up
+   to EVICT_BATCH frames, keeping the ones not needed right away
+   on free_frames, and the pages among them bound for swap, at
+   most SWAP_BATCH, are sorted by owner and address and written
+   to a run of adjacent swap slots.  Neighbouring pages of a process thus tend to land
+   in neighbouring slots, where page_in() can read them back
+   together.
+
+   The working-set scanner (see vm/wss.c) also samples accessed
+   bits, and leaves what it takes in each page's `referenced'
+   for the clock hand to find.  On its first lap the hand passes
+   over frames in their owners' working sets, so that a process
+   that has outgrown its working set gives up its idle pages
+   before a process still using all of its own does.
+
+   The frame table is also the page cache.  A page of a file read
+   in for a page fault, or for read(), goes into a frame entered
+   in page_cache, keyed by inode number and offset, and every
+   process that faults on that part of the file, or reads it,
+   uses the same frame instead of copying the file into one of
+   its own.  Writable pages are mapped read-only to the cache
+   frame and copied on their first write.  File writes still go
+   through the buffer cache, and are copied into any cache frame
+   they touch on the way.  A cache frame whose last page goes
+   away stays in the cache, idle, and the clock hand gives it a
+   second chance like any other frame, unless idle cache frames
+   make up more than CACHE_IDLE_PCT percent of all frames, in
+   which case they go first.  read() only brings pages into the
+   cache from free memory, so that streaming through a big file
+   never pushes out anonymous pages.
+
+   After a fork, parent and child also share frames, read-only,
+   until one of them writes; frame_unshare() then gives the
+   writer a copy.  Other frames go away when their last page
+   does.
+
+   frame_lock protects the list, the hand, the page cache, and
+   the `frame', `pinned', `swapping' and `frame_elem' members of
+   every page.  It is dropped while a batch goes to swap, or while
+   dirty mapped pages are written back to their files, so that
+   page faults, pinning and the file system can go on meanwhile.
+   The pages in such a batch are marked `swapping' and their
+   frames are kept off both lists until the write is done; a
+   thread that wants one of those pages back, or wants to free it,
+   waits in frame_alloc() or frame_free_page() until the page has
+   reached swap or its file. */
+
+/* Most frames reclaimed by one eviction. */
+#define EVICT_BATCH 8
+
+/* Most pages written to swap as one run of slots. */
+#define SWAP_BATCH 16
+
+/* Share of all frames, in percent, that idle page cache frames
+   may take up before eviction prefers them to anything else. */
+#define CACHE_IDLE_PCT 25
+
+static struct list frame_list;
+static struct list free_frames;     /* Reclaimed frames not yet reused. */
+static struct list_elem *clock_hand;
+static size_t frame_cnt;            /* Frames taken from the user pool. */
+static struct hash page_cache;
+static size_t idle_cnt;             /* Page cache frames with no pages. */
+static unsigned cache_gen;          /* Bumped by writes to cached files. */
+static struct lock frame_lock;
+static struct condition swap_done;  /* Signaled when pages reach swap. */
+
+/* A page of zeros, mapped read-only for reads of PAGE_ZERO pages
+   that have never been written.  It is not on frame_list and is
+   never evicted or freed. */
+static void *zero_kpage;
+
+/* Page cache statistics. */
+static unsigned cache_fill_cnt;     /* Pages read into the cache. */
+static unsigned cache_map_cnt;      /* Faults that mapped a cached page. */
+static unsigned cache_read_bytes;   /* read() bytes copied from it. */
+
+static bool frame_evict (void);
+
+/* The page cache is keyed by inode number and page offset alone.
+   Two users of the same page may still want different amounts of
+   the file in it, the rest zeroed, so each must check the cached
+   frame's LEN before using it; see frame_cache_map(). */
+static unsigned
+cache_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, cache_elem);
+  return hash_int (f->inumber) ^ hash_int (f->ofs);
+}
+
+static bool
+cache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, cache_elem);
+  const struct frame *b = hash_entry (b_, struct frame, cache_elem);
+  if (a->inumber != b->inumber)
+    return a->inumber < b->inumber;
+  return a->ofs < b->ofs;
+}
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  list_init (&frame_list);
+  list_init (&free_frames);
+  clock_hand = NULL;
+  hash_init (&page_cache, cache_hash, cache_less, NULL);
+  lock_init_named (&frame_lock, "frame_lock");
+  cond_init (&swap_done);
+  zero_kpage = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Maps PAGE_ZERO page P, which must not be resident, read-only to
+   the shared zero page, so that reading it costs no frame.  A
+   write to it faults and gets it a frame of its own.  Returns
+   false if P is resident or no longer a PAGE_ZERO page, or if
+   memory is short. */
+bool
+frame_map_zero (struct page *p)
+{
+  bool success = false;
+
+  lock_acquire (&frame_lock);
+  if (p->frame == NULL && p->type == PAGE_ZERO)
+    success = pagedir_set_page (p->owner->pagedir, p->upage, zero_kpage,
+                                false);
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Waits until page P, if it is being written to swap or to its
+   file, gets there.  frame_lock must be held. */
+static void
+frame_wait_swap (struct page *p)
+{
+  while (p->swapping)
+    cond_wait (&swap_done, &frame_lock);
+}
+
+/* Adds page P to frame F's pages and pins it. */
+static void
+frame_attach (struct frame *f, struct page *p)
+{
+  if (f->cached && list_empty (&f->pages))
+    idle_cnt--;
+  list_push_back (&f->pages, &p->frame_elem);
+  p->frame = f;
+  p->pinned = true;
+}
+
+/* Obtains a frame, evicting other pages if the user pool is
+   exhausted and EVICT is true, and zeroes it if ZERO is true.
+   Returns a null pointer if no frame can be had.  The caller must
+   hold frame_lock and fill in the frame's pages. */
+static struct frame *
+frame_get (bool zero, bool evict)
+{
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  /* frame_evict() drops the lock while it writes to swap, so
+     others may take the frames it reclaims first. */
+  while (list_empty (&free_frames))
+    {
+      void *kpage = palloc_get_page (PAL_USER);
+      if (kpage != NULL)
+        {
+          f = malloc (sizeof *f);
+          if (f == NULL)
+            {
+              palloc_free_page (kpage);
+              return NULL;
+            }
+          f->kpage = kpage;
+          list_push_back (&free_frames, &f->elem);
+          frame_cnt++;
+        }
+      else if (!evict || !frame_evict ())
+        return NULL;
+    }
+
+  f = list_entry (list_pop_front (&free_frames), struct frame, elem);
+  if (zero)
+    memset (f->kpage, 0, PGSIZE);
+  list_push_back (&frame_list, &f->elem);
+  list_init (&f->pages);
+  f->cached = false;
+  f->referenced = false;
+  return f;
+}
+
+/* Frees frame F, which must have no pages and not be in the page
+   cache. */
+static void
+frame_release (struct frame *f)
+{
+  ASSERT (list_empty (&f->pages) && !f->cached);
+
+  if (clock_hand == &f->elem)
+    clock_hand = list_next (clock_hand);
+  list_remove (&f->elem);
+  palloc_free_page (f->kpage);
+  free (f);
+  frame_cnt--;
+}
+
+/* Removes page P from its frame.  The frame is freed along with
+   its last page, unless it is in the page cache, where it stays,
+   idle. */
+static void
+frame_detach (struct page *p)
+{
+  struct frame *f = p->frame;
+
+  list_remove (&p->frame_elem);
+  p->frame = NULL;
+  p->pinned = false;
+  if (list_empty (&f->pages))
+    {
+      if (f->cached)
+        {
+          idle_cnt++;
+          f->referenced = true;
+        }
+      else
+        frame_release (f);
+    }
+}
+
+/* Obtains a frame for page P, evicting another page if the user
+   pool is exhausted, and zeroes it if ZERO is true.  The frame is
+   returned pinned, so that it can be filled in peace; the caller
+   unpins it once it is mapped.  Returns a null pointer if no
+   frame can be had. */
+struct frame *
+frame_alloc (struct page *p, bool zero)
+{
+  struct frame *f;
+
+  ASSERT (p->frame == NULL);
+
+  lock_acquire (&frame_lock);
+  frame_wait_swap (p);
+  f = frame_get (zero, true);
+  if (f != NULL)
+    frame_attach (f, p);
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Like frame_alloc(), but only uses free memory, never evicting
+   anything, and returns a null pointer if P is already resident.
+   For reading ahead, which is not worth a page already in use. */
+struct frame *
+frame_try_alloc (struct page *p)
+{
+  struct frame *f = NULL;
+
+  lock_acquire (&frame_lock);
+  if (p->frame == NULL && !p->swapping)
+    {
+      f = frame_get (false, false);
+      if (f != NULL)
+        frame_attach (f, p);
+    }
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Returns the page cache frame for offset OFS of file INUMBER, or
+   a null pointer if there is none.  frame_lock must be held. */
+static struct frame *
+cache_lookup (disk_sector_t inumber, off_t ofs)
+{
+  struct frame key;
+  struct hash_elem *e;
+
+  key.inumber = inumber;
+  key.ofs = ofs;
+  e = hash_find (&page_cache, &key.cache_elem);
+  return e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+}
+
+/* Takes frame F out of the page cache, freeing it if no pages
+   map it.  frame_lock must be held. */
+static void
+cache_drop (struct frame *f)
+{
+  ASSERT (f->cached);
+
+  hash_delete (&page_cache, &f->cache_elem);
+  f->cached = false;
+  if (list_empty (&f->pages))
+    {
+      idle_cnt--;
+      frame_release (f);
+    }
+}
+
+/* Returns true if idle page cache frames take up more than their
+   share of memory. */
+static bool
+cache_over_limit (void)
+{
+  return idle_cnt * 100 > frame_cnt * CACHE_IDLE_PCT;
+}
+
+/* Reads LEN bytes at offset OFS of INODE, with the rest of the
+   page zeroed, into a new frame, evicting other pages for it if
+   EVICT is true, and enters the frame into the page cache, idle.
+   If another thread cached the page meanwhile, returns its frame
+   instead.  Returns a null pointer if no frame can be had, if the
+   read fails, or if the file was written during the read, which
+   might have left the frame stale.  frame_lock must be held; it
+   is released during the read. */
+static struct frame *
+cache_fill (struct inode *inode, off_t ofs, size_t len, bool evict)
+{
+  disk_sector_t inumber = inode_get_inumber (inode);
+  struct frame *f, *other;
+  unsigned gen;
+  bool ok;
+
+  f = frame_get (false, evict);
+  if (f == NULL)
+    return NULL;
+
+  /* Keep F out of the clock hand's way while it is filled. */
+  list_remove (&f->elem);
+  gen = cache_gen;
+  lock_release (&frame_lock);
+  ok = inode_read_page (inode, f->kpage, ofs, len);
+  lock_acquire (&frame_lock);
+
+  other = cache_lookup (inumber, ofs);
+  if (!ok || other != NULL || gen != cache_gen)
+    {
+      list_push_back (&free_frames, &f->elem);
+      return ok && gen == cache_gen ? other : NULL;
+    }
+
+  list_push_back (&frame_list, &f->elem);
+  f->cached = true;
+  f->referenced = true;
+  f->inumber = inumber;
+  f->ofs = ofs;
+  f->len = len;
+  hash_insert (&page_cache, &f->cache_elem);
+  idle_cnt++;
+  cache_fill_cnt++;
+  return f;
+}
+
+/* Adds page P of the running thread to the page cache frame that
+   holds LEN bytes at offset OFS of INODE, with the rest of the
+   page zeroed, reading it into the cache first if need be, and
+   returns the frame pinned, like frame_alloc().  The frame is
+   shared, so P must be mapped read-only.  Returns a null pointer
+   if memory is short, or if the cached page holds a different
+   amount of the file, as the last page of one segment of an
+   executable and the first page of the next may; P must then get
+   a frame of its own. */
+struct frame *
+frame_cache_map (struct page *p, struct inode *inode, off_t ofs,
+                 size_t len)
+{
+  struct frame *f;
+
+  ASSERT (p->frame == NULL);
+  ASSERT (ofs % PGSIZE == 0 && len <= PGSIZE);
+
+  lock_acquire (&frame_lock);
+  f = cache_lookup (inode_get_inumber (inode), ofs);
+  if (f != NULL && f->len == len)
+    cache_map_cnt++;
+  else if (f == NULL)
+    f = cache_fill (inode, ofs, len, true);
+  if (f != NULL && f->len == len)
+    frame_attach (f, p);
+  else
+    f = NULL;
+  lock_release (&frame_lock);
+  return f;
+}
+
+/* Copies SIZE bytes at offset OFS of INODE, which must lie within
+   a single page, from the page cache into BUFFER, first reading
+   the page into the cache if there is a free frame for it.
+   Returns false if that cannot be done; the caller must then read
+   the bytes from the file system itself.  BUFFER must not fault. */
+bool
+frame_cache_read (struct inode *inode, void *buffer, off_t size,
+                  off_t ofs)
+{
+  off_t page_ofs = ofs - ofs % PGSIZE;
+  struct frame *f;
+  bool success = false;
+
+  ASSERT (ofs - page_ofs + size <= PGSIZE);
+
+  lock_acquire (&frame_lock);
+  f = cache_lookup (inode_get_inumber (inode), page_ofs);
+  if (f == NULL)
+    {
+      off_t left = inode_length (inode) - page_ofs;
+      if (left > 0)
+        f = cache_fill (inode, page_ofs, left < PGSIZE ? left : PGSIZE,
+                        false);
+    }
+  if (f != NULL && (size_t) (ofs - page_ofs + size) <= f->len)
+    {
+      memcpy (buffer, (uint8_t *) f->kpage + (ofs - page_ofs), size);
+      f->referenced = true;
+      cache_read_bytes += size;
+      success = true;
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Copies the SIZE bytes just written at offset OFS of INODE from
+   BUFFER into the page cache frames that hold them, keeping the
+   cache in step with the file.  A cached page that holds less
+   than the part of the file written is dropped from the cache
+   instead. */
+void
+frame_cache_write (struct inode *inode, const void *buffer_, off_t size,
+                   off_t ofs)
+{
+  const uint8_t *buffer = buffer_;
+  disk_sector_t inumber = inode_get_inumber (inode);
+
+  lock_acquire (&frame_lock);
+  cache_gen++;
+  while (size > 0)
+    {
+      off_t page_ofs = ofs - ofs % PGSIZE;
+      off_t chunk = PGSIZE - (ofs - page_ofs);
+      struct frame *f;
+
+      if (chunk > size)
+        chunk = size;
+      f = cache_lookup (inumber, page_ofs);
+      if (f != NULL)
+        {
+          if ((size_t) (ofs - page_ofs + chunk) <= f->len)
+            memcpy ((uint8_t *) f->kpage + (ofs - page_ofs), buffer, chunk);
+          else
+            cache_drop (f);
+        }
+      buffer += chunk;
+      ofs += chunk;
+      size -= chunk;
+    }
+  lock_release (&frame_lock);
+}
+
+/* Drops all of INODE's pages from the page cache, because its
+   blocks are being freed and its inode number may be reused. */
+void
+frame_cache_forget (struct inode *inode)
+{
+  disk_sector_t inumber = inode_get_inumber (inode);
+  struct list_elem *e, *next;
+
+  lock_acquire (&frame_lock);
+  cache_gen++;
+  for (e = list_begin (&frame_list); e != list_end (&frame_list); e = next)
+    {
+      struct frame *f = list_entry (e, struct frame, elem);
+
+      next = list_next (e);
+      if (f->cached && f->inumber == inumber)
+        cache_drop (f);
+    }
+  lock_release (&frame_lock);
+}
+
+/* Adds page C, of the running thread, to the frame of resident
+   page P, which must be pinned, for copy-on-write: both pages
+   are mapped read-only until one of them is written.  If P has
+   been modified, or came from swap, both pages become PAGE_SWAP
+   pages, since their contents can no longer be recreated from
+   their source.  Returns false if C cannot be mapped. */
+bool
+frame_cow_share (struct page *p, struct page *c)
+{
+  uint32_t *pd = p->owner->pagedir;
+  bool success = false;
+
+  lock_acquire (&frame_lock);
+  ASSERT (p->frame != NULL && p->pinned);
+  if (pagedir_set_page (c->owner->pagedir, c->upage, p->frame->kpage,
+                        false))
+    {
+      if (p->writable)
+        {
+          if (pagedir_is_dirty (pd, p->upage))
+            p->type = PAGE_SWAP;
+          pagedir_set_writable (pd, p->upage, false);
+        }
+      c->type = p->type;
+      list_push_back (&p->frame->pages, &c->frame_elem);
+      c->frame = p->frame;
+      success = true;
+    }
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Gives resident, pinned page P a frame of its own, copying the
+   frame it shares if other pages still map it or it is in the
+   page cache, and lets its owner write it.  Returns false if
+   memory is short. */
+bool
+frame_unshare (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+  struct frame *f, *copy;
+  bool success = true;
+
+  lock_acquire (&frame_lock);
+  f = p->frame;
+  ASSERT (f != NULL && p->pinned);
+  if (list_size (&f->pages) == 1 && !f->cached)
+    pagedir_set_writable (pd, p->upage, true);
+  else if ((copy = frame_get (false, true)) != NULL)
+    {
+      memcpy (copy->kpage, f->kpage, PGSIZE);
+      frame_detach (p);
+      frame_attach (copy, p);
+      pagedir_clear_page (pd, p->upage);
+      success = pagedir_set_page (pd, p->upage, copy->kpage, true);
+      ASSERT (success);
+    }
+  else
+    success = false;
+  lock_release (&frame_lock);
+  return success;
+}
+
+/* Returns true if any page of F is pinned. */
+static bool
+frame_is_pinned (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (list_entry (e, struct page, frame_elem)->pinned)
+      return true;
+  return false;
+}
+
+/* Returns true if any page of F has been accessed since the last
+   call, or F has been used through the page cache, clearing the
+   accessed bits, and the bits taken by the working-set scanner,
+   as it goes. */
+static bool
+frame_test_and_clear_accessed (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = f->referenced;
+
+  f->referenced = false;
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      uint32_t *pd = p->owner->pagedir;
+
+      if (pagedir_is_accessed (pd, p->upage))
+        {
+          pagedir_set_accessed (pd, p->upage, false);
+          accessed = true;
+        }
+      if (p->referenced)
+        {
+          p->referenced = false;
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Returns true if any page of F is in its owner's working set. */
+static bool
+frame_in_working_set (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (wss_page_active (list_entry (e, struct page, frame_elem)))
+      return true;
+  return false;
+}
+
+/* A page on its way to swap or to its file. */
+struct evict_request
+  {
+    struct page *page;          /* Page being evicted. */
+    void *kpage;                /* Its contents. */
+  };
+
+/* Orders eviction requests by owner, then by user address. */
+static bool
+evict_request_less (const struct evict_request *a,
+                    const struct evict_request *b)
+{
+  if (a->page->owner != b->page->owner)
+    return a->page->owner < b->page->owner;
+  return a->page->upage < b->page->upage;
+}
+
+/* Writes the CNT pages in REQS, which must be marked `swapping',
+   to swap, in order of owner and address, in a single run of
+   adjacent slots if there is one.  frame_lock must be held; it is
+   released during the write. */
+static void
+frame_swap_out (struct evict_request reqs[], size_t cnt)
+{
+  size_t slot, i;
+
+  ASSERT (cnt <= SWAP_BATCH);
+  if (cnt == 0)
+    return;
+
+  /* Insertion sort; there are never more than SWAP_BATCH. */
+  for (i = 1; i < cnt; i++)
+    {
+      struct evict_request r = reqs[i];
+      size_t j;
+
+      for (j = i; j > 0 && evict_request_less (&r, &reqs[j - 1]); j--)
+        reqs[j] = reqs[j - 1];
+      reqs[j] = r;
+    }
+
+  slot = swap_alloc (cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = reqs[i].page;
+
+      p->swap_slot = slot != SWAP_SLOT_NONE ? slot + i : swap_alloc (1);
+    }
+
+  lock_release (&frame_lock);
+  if (slot != SWAP_SLOT_NONE)
+    {
+      void *kpages[SWAP_BATCH];
+
+      for (i = 0; i < cnt; i++)
+        kpages[i] = reqs[i].kpage;
+      swap_write_pages (slot, kpages, cnt);
+    }
+  else
+    for (i = 0; i < cnt; i++)
+      swap_write (reqs[i].page->swap_slot, reqs[i].kpage);
+  lock_acquire (&frame_lock);
+
+  for (i = 0; i < cnt; i++)
+    reqs[i].page->swapping = false;
+  cond_broadcast (&swap_done, &frame_lock);
+}
+
+/* Writes the CNT dirty mapped pages in REQS, which must be marked
+   `swapping', back to their files.  frame_lock must be held; it is
+   released during the writes. */
+static void
+frame_write_back (struct evict_request reqs[], size_t cnt)
+{
+  size_t i;
+
+  if (cnt == 0)
+    return;
+
+  lock_release (&frame_lock);
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *p = reqs[i].page;
+      file_write_at (p->file, reqs[i].kpage, p->read_bytes, p->ofs);
+    }
+  lock_acquire (&frame_lock);
+
+  for (i = 0; i < cnt; i++)
+    reqs[i].page->swapping = false;
+  cond_broadcast (&swap_done, &frame_lock);
+}
+
+/* Reclaims up to EVICT_BATCH frames, moving their pages out, and
+   puts them on free_frames.  Returns false if every frame is
+   pinned.  Releases frame_lock while writing to swap or to
+   mapped files. */
+static bool
+frame_evict (void)
+{
+  struct list reclaimed;
+  struct evict_request reqs[SWAP_BATCH], writes[SWAP_BATCH];
+  size_t req_cnt = 0, write_cnt = 0, evict_cnt = 0;
+  size_t lap = list_size (&frame_list);
+  size_t i, n = 2 * lap + 1;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  /* Reclaimed frames stay off free_frames until their contents
+     are safely in swap or in their files. */
+  list_init (&reclaimed);
+  for (i = 0; i < n && evict_cnt < EVICT_BATCH; i++)
+    {
+      struct frame *f;
+
+      if (clock_hand == NULL || clock_hand == list_end (&frame_list))
+        clock_hand = list_begin (&frame_list);
+      if (clock_hand == list_end (&frame_list))
+        break;
+      f = list_entry (clock_hand, struct frame, elem);
+      clock_hand = list_next (clock_hand);
+
+      /* Idle page cache frames beyond their share of memory go
+         first, whether used lately or not. */
+      if (!(list_empty (&f->pages) && cache_over_limit ())
+          && (frame_is_pinned (f) || frame_test_and_clear_accessed (f)
+              || (i < lap && frame_in_working_set (f))))
+        continue;
+
+      /* The batch is written out in one go, so stop short of
+         overflowing it, coming back to F next time.  A frame
+         shared by more pages than a batch holds is passed over. */
+      if (req_cnt + write_cnt + list_size (&f->pages) > SWAP_BATCH)
+        {
+          if (req_cnt + write_cnt == 0)
+            continue;
+          clock_hand = &f->elem;
+          break;
+        }
+
+      if (f->cached)
+        {
+          hash_delete (&page_cache, &f->cache_elem);
+          f->cached = false;
+          if (list_empty (&f->pages))
+            idle_cnt--;
+        }
+      while (!list_empty (&f->pages))
+        {
+          struct page *p = list_entry (list_pop_front (&f->pages),
+                                       struct page, frame_elem);
+          if (page_out (p))
+            {
+              struct evict_request *r = (p->type == PAGE_MMAP
+                                         ? &writes[write_cnt++]
+                                         : &reqs[req_cnt++]);
+              r->page = p;
+              r->kpage = f->kpage;
+
+              /* Marked now, not by the writer: the lock is dropped
+                 for the swap batch while write-backs still wait,
+                 and the other way around. */
+              p->swapping = true;
+            }
+          p->frame = NULL;
+        }
+      list_remove (&f->elem);
+      list_push_back (&reclaimed, &f->elem);
+      evict_cnt++;
+    }
+  frame_swap_out (reqs, req_cnt);
+  frame_write_back (writes, write_cnt);
+  while (!list_empty (&reclaimed))
+    list_push_back (&free_frames, list_pop_front (&reclaimed));
+  return evict_cnt > 0;
+}
+
+/* Calls FUNC on every resident page, passing along AUX, with the
+   frame table locked. */
+void
+frame_for_each_page (void (*func) (struct page *, void *aux), void *aux)
+{
+  struct list_elem *e, *pe;
+
+  lock_acquire (&frame_lock);
+  for (e = list_begin (&frame_list); e != list_end (&frame_list);
+       e = list_next (e))
+    {
+      struct frame *f = list_entry (e, struct frame, elem);
+
+      for (pe = list_begin (&f->pages); pe != list_end (&f->pages);
+           pe = list_next (pe))
+        func (list_entry (pe, struct page, frame_elem), aux);
+    }
+  lock_release (&frame_lock);
+}
+
+/* Detaches P from its frame, if it has one, and removes P's
+   mapping from its owner's page directory.  The frame itself is
+   freed along with its last page, unless it is in the page
+   cache. */
+void
+frame_free_page (struct page *p)
+{
+  lock_acquire (&frame_lock);
+  frame_wait_swap (p);
+  if (p->frame != NULL)
+    {
+      if (p->owner->pagedir != NULL)
+        pagedir_clear_page (p->owner->pagedir, p->upage);
+      frame_detach (p);
+    }
+  lock_release (&frame_lock);
+}
+
+/* Pins P's frame, if it has one, so that it will not be evicted.
+   Returns true if P is resident, false otherwise. */
+bool
+frame_pin_page (struct page *p)
+{
+  bool resident;
+
+  lock_acquire (&frame_lock);
+  resident = p->frame != NULL;
+  if (resident)
+    p->pinned = true;
+  lock_release (&frame_lock);
+  return resident;
+}
+
+/* Unpins P's frame, if it has one. */
+void
+frame_unpin_page (struct page *p)
+{
+  lock_acquire (&frame_lock);
+  p->pinned = false;
+  lock_release (&frame_lock);
+}
+
+/* Reports the pages in the page cache, the page faults that have
+   mapped a cached page, and the bytes read() has copied from the
+   cache. */
+void
+frame_get_cache_stats (unsigned *pages, unsigned *mapped,
+                       unsigned *read_bytes)
+{
+  lock_acquire (&frame_lock);
+  *pages = hash_size (&page_cache);
+  *mapped = cache_map_cnt;
+  *read_bytes = cache_read_bytes;
+  lock_release (&frame_lock);
+}
+
+/* Prints page cache statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Page cache: %zu pages (%zu idle), %u read in, "
+          "%u faults mapped a cached page (%u kB not copied), "
+          "%u bytes read from it\n",
+          hash_size (&page_cache), idle_cnt, cache_fill_cnt,
+          cache_map_cnt, cache_map_cnt * (PGSIZE / 1024),
+          cache_read_bytes);
+}
@@ -0,0 +1,57 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "devices/disk.h"
+#include "filesys/off_t.h"
+
+struct inode;
+struct page;
+
+/* A physical frame holding a user page.
+
+   A frame normally holds a single process's page.  A frame in the
+   page cache instead holds a page of a file, found by INUMBER and
+   OFS, and is shared by every page that maps that part of the
+   file; it stays in the cache, idle, after the last of them goes
+   away. */
+struct frame
+  {
+    void *kpage;                /* Kernel virtual address. */
+    struct list pages;          /* Pages mapped to this frame. */
+    struct list_elem elem;      /* Element in frame list. */
+
+    /* Page cache frames only. */
+    bool cached;                /* In the page cache? */
+    bool referenced;            /* Used since the clock hand passed? */
+    disk_sector_t inumber;      /* Inode the contents came from. */
+    off_t ofs;                  /* Page-aligned offset in the file. */
+    size_t len;                 /* Bytes from the file; the rest is
+                                   zeros. */
+    struct hash_elem cache_elem; /* Element in page cache. */
+  };
+
+void frame_init (void);
+struct frame *frame_alloc (struct page *, bool zero);
+struct frame *frame_try_alloc (struct page *);
+struct frame *frame_cache_map (struct page *, struct inode *, off_t ofs,
+                               size_t len);
+bool frame_cache_read (struct inode *, void *, off_t size, off_t ofs);
+void frame_cache_write (struct inode *, const void *, off_t size,
+                        off_t ofs);
+void frame_cache_forget (struct inode *);
+void frame_get_cache_stats (unsigned *pages, unsigned *mapped,
+                            unsigned *read_bytes);
+void frame_print_stats (void);
+bool frame_cow_share (struct page *, struct page *);
+bool frame_unshare (struct page *);
+bool frame_map_zero (struct page *);
+void frame_free_page (struct page *);
+bool frame_pin_page (struct page *);
+void frame_for_each_page (void (*func) (struct page *, void *aux),
+                          void *aux);
+void frame_unpin_page (struct page *);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,139 @@
+#include "vm/mmap.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* Memory-mapped files.
+
+   A mapping just adds a PAGE_MMAP entry to the supplemental page
+   table for each page of the file.  The pages are read in on
+   first touch and written back, when dirty, as they are evicted
+   or as the mapping is removed, so a mapping costs nothing until
+   it is used.  Each mapping holds its own reopened file, so it
+   outlives the file descriptor it was made from. */
+
+/* A memory-mapped file. */
+struct mapping
+  {
+    mapid_t id;                 /* Mapping identifier. */
+    struct file *file;          /* Mapped file. */
+    uint8_t *addr;              /* First mapped page. */
+    size_t page_cnt;            /* Number of mapped pages. */
+    struct list_elem elem;      /* Element in thread's `mappings'. */
+  };
+
+static void unmap (struct mapping *);
+
+/* Maps FILE into the running process's address space starting at
+   page-aligned ADDR.  Returns the new mapping's identifier, or
+   MAP_FAILED if FILE is empty, ADDR is unsuitable, or the mapping
+   would overlap a page that is already in use. */
+mapid_t
+mmap_map (struct file *file, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct mapping *m;
+  off_t length;
+  size_t i;
+
+  if (addr == NULL || pg_ofs (addr) != 0)
+    return MAP_FAILED;
+
+  sema_down (&file_sema);
+  length = file_length (file);
+  sema_up (&file_sema);
+  if (length == 0
+      || (uintptr_t) length > (uintptr_t) PHYS_BASE - (uintptr_t) addr)
+    return MAP_FAILED;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return MAP_FAILED;
+  m->addr = addr;
+  m->page_cnt = DIV_ROUND_UP (length, PGSIZE);
+  for (i = 0; i < m->page_cnt; i++)
+    if (page_lookup (m->addr + i * PGSIZE) != NULL)
+      {
+        free (m);
+        return MAP_FAILED;
+      }
+
+  sema_down (&file_sema);
+  m->file = file_reopen (file);
+  sema_up (&file_sema);
+  if (m->file == NULL)
+    {
+      free (m);
+      return MAP_FAILED;
+    }
+
+  for (i = 0; i < m->page_cnt; i++)
+    {
+      off_t ofs = i * PGSIZE;
+      size_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+      if (!page_add_mmap (m->addr + ofs, m->file, ofs, read_bytes))
+        {
+          m->page_cnt = i;
+          unmap (m);
+          return MAP_FAILED;
+        }
+    }
+
+  m->id = t->next_mapid++;
+  list_push_back (&t->mappings, &m->elem);
+  return m->id;
+}
+
+/* Writes back and removes the pages of mapping M, closes its
+   file, and frees it.  M must not be on the mappings list. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  for (i = 0; i < m->page_cnt; i++)
+    page_remove (m->addr + i * PGSIZE);
+  sema_down (&file_sema);
+  file_close (m->file);
+  sema_up (&file_sema);
+  free (m);
+}
+
+/* Removes the running process's mapping ID, writing back any
+   pages that were modified.  Returns false if there is no such
+   mapping. */
+bool
+mmap_unmap (mapid_t id)
+{
+  struct list *mappings = &thread_current ()->mappings;
+  struct list_elem *e;
+
+  for (e = list_begin (mappings); e != list_end (mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        {
+          list_remove (e);
+          unmap (m);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Removes all of the running process's mappings. */
+void
+mmap_unmap_all (void)
+{
+  struct list *mappings = &thread_current ()->mappings;
+
+  while (!list_empty (mappings))
+    unmap (list_entry (list_pop_front (mappings), struct mapping, elem));
+}
@@ -0,0 +1,601 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Supplemental page table.
+
+   Each user process has a hash table, keyed by user virtual
+   page, describing every page of its address space: where the
+   page's contents come from and whether it may be written.
+   Pages are brought into memory by page_load() the first time
+   they are touched, rather than when the process is loaded.
+
+   Pages are read from, and mapped pages written back to, their
+   backing file without taking file_sema.  A fault may arrive
+   while the faulting thread already holds it (for example, while
+   the file system copies a user-supplied file name), and so may
+   an eviction.  An executable being run cannot change underneath
+   us because load() denies writes to it; a mapped file can, but
+   the buffer cache keeps each sector consistent and mapped I/O
+   never extends the file.
+
+   Executable pages are mapped straight to the frames of the page
+   cache (see vm/frame.c), and so shared with any other process
+   running the same executable; writable ones are mapped read-only
+   until they are first written, and then copied.
+
+   Reads of PAGE_ZERO pages that have never been written are
+   served by a single shared page of zeros, mapped read-only; a
+   write then faults and gets the page a frame of its own.
+
+   fork() shares the parent's resident pages with the child
+   copy-on-write; see page_table_copy() and page_unshare().
+
+   A resident page may be evicted by frame_alloc() at any time
+   unless its frame is pinned.  Clean pages that can be recreated
+   from their source are simply dropped, dirty PAGE_MMAP pages are
+   written back to their file, and anything else becomes a
+   PAGE_SWAP page and goes to the swap disk.  Bringing a page
+   back from swap also brings in, as far as free memory allows,
+   neighbouring pages that were swapped out alongside it. */
+
+/* Most pages read around a swapped-in page, on each side. */
+#define SWAP_READ_AROUND 4
+
+static bool page_in (struct page *, bool pin);
+static void page_read_around (struct page *, size_t slot);
+
+/* Stack limit; set with the -sl kernel command line option. */
+size_t stack_limit = 8 * 1024 * 1024;
+
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, elem);
+  const struct page *b = hash_entry (b_, struct page, elem);
+  return a->upage < b->upage;
+}
+
+/* Initializes the running thread's supplemental page table.
+   Returns true if successful, false on memory allocation
+   failure. */
+bool
+page_table_init (void)
+{
+  return hash_init (&thread_current ()->pages, page_hash, page_less, NULL);
+}
+
+static void
+page_destroy (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *p = hash_entry (e, struct page, elem);
+
+  /* Unmapping the page also keeps pagedir_destroy() from freeing
+     the shared zero page, which may still be mapped here. */
+  frame_free_page (p);
+  pagedir_clear_page (p->owner->pagedir, p->upage);
+  if (p->type == PAGE_SWAP && p->swap_slot != SWAP_SLOT_NONE)
+    swap_free (p->swap_slot);
+  free (p);
+}
+
+/* Destroys the running thread's supplemental page table,
+   releasing the frames and swap slots of its pages.  Must be
+   called before the page directory is destroyed. */
+void
+page_table_destroy (void)
+{
+  struct hash *pages = &thread_current ()->pages;
+
+  /* Kernel threads and processes that failed early never got a
+     table. */
+  if (pages->buckets != NULL)
+    hash_destroy (pages, page_destroy);
+}
+
+/* Adds a page at UPAGE to the running thread's supplemental page
+   table, of the given TYPE.  Returns the new page, or a null
+   pointer if UPAGE is already in the table or memory is short. */
+static struct page *
+page_add (void *upage, enum page_type type, bool writable)
+{
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->type = type;
+  p->writable = writable;
+  p->owner = thread_current ();
+  p->frame = NULL;
+  p->pinned = false;
+  p->swap_slot = SWAP_SLOT_NONE;
+  p->swapping = false;
+  p->last_used = 0;
+  p->referenced = false;
+  p->file = NULL;
+  p->ofs = 0;
+  p->read_bytes = 0;
+  if (hash_insert (&thread_current ()->pages, &p->elem) != NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Copies the address space of PARENT, which must be blocked, into
+   the running thread's supplemental page table for fork().
+   Resident pages, and pages in swap, are shared copy-on-write;
+   the rest are recorded to be loaded from the same source as the
+   parent's.  Mapped files are not inherited.  Returns true if
+   successful, false if memory is short. */
+bool
+page_table_copy (struct thread *parent)
+{
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+
+  hash_first (&i, &parent->pages);
+  while (hash_next (&i))
+    {
+      struct page *p = hash_entry (hash_cur (&i), struct page, elem);
+      struct page *c;
+      bool resident;
+
+      if (p->type == PAGE_MMAP)
+        continue;
+
+      /* A page changes type only when it is evicted, so once it is
+         pinned, or known not to be resident, its type is stable.
+         Swap slots are not shared, so bring swapped pages in. */
+      resident = frame_pin_page (p);
+      if (!resident && p->type == PAGE_SWAP)
+        {
+          if (!page_in (p, true))
+            return false;
+          resident = true;
+        }
+
+      c = page_add (p->upage, p->type, p->writable);
+      if (c != NULL)
+        {
+          ASSERT (p->file == NULL || p->file == parent->exec_file);
+          c->file = p->file != NULL ? t->exec_file : NULL;
+          c->ofs = p->ofs;
+          c->read_bytes = p->read_bytes;
+        }
+      if (resident)
+        {
+          bool shared = c != NULL && frame_cow_share (p, c);
+          frame_unpin_page (p);
+          if (!shared)
+            return false;
+        }
+      else if (c == NULL)
+        return false;
+    }
+  return true;
+}
+
+/* Records that UPAGE is to be loaded from READ_BYTES bytes of
+   FILE starting at offset OFS, with the rest of the page zeroed.
+   Returns true if successful, false otherwise. */
+bool
+page_add_file (void *upage, struct file *file, off_t ofs,
+               size_t read_bytes, bool writable)
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  if (read_bytes == 0)
+    return page_add_zero (upage, writable);
+  p = page_add (upage, PAGE_FILE, writable);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  return true;
+}
+
+/* Records that UPAGE is to be zero-filled.  Returns true if
+   successful, false otherwise. */
+bool
+page_add_zero (void *upage, bool writable)
+{
+  return page_add (upage, PAGE_ZERO, writable) != NULL;
+}
+
+/* Records that UPAGE maps READ_BYTES bytes of FILE starting at
+   offset OFS, with the rest of the page zeroed, and that changes
+   to it are to be written back to FILE.  Returns true if
+   successful, false otherwise. */
+bool
+page_add_mmap (void *upage, struct file *file, off_t ofs,
+               size_t read_bytes)
+{
+  struct page *p;
+
+  ASSERT (read_bytes > 0 && read_bytes <= PGSIZE);
+
+  p = page_add (upage, PAGE_MMAP, true);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->ofs = ofs;
+  p->read_bytes = read_bytes;
+  return true;
+}
+
+/* Removes UPAGE from the running thread's address space, first
+   writing it back to its file if it is a modified PAGE_MMAP
+   page. */
+void
+page_remove (void *upage)
+{
+  struct thread *t = thread_current ();
+  struct page *p = page_lookup (upage);
+
+  if (p == NULL)
+    return;
+  if (p->type == PAGE_MMAP && frame_pin_page (p)
+      && pagedir_is_dirty (t->pagedir, p->upage))
+    file_write_at (p->file, p->frame->kpage, p->read_bytes, p->ofs);
+  hash_delete (&t->pages, &p->elem);
+  page_destroy (&p->elem, NULL);
+}
+
+/* Returns the running thread's page containing UADDR, or a null
+   pointer if there is none. */
+struct page *
+page_lookup (const void *uaddr)
+{
+  struct page p;
+  struct hash_elem *e;
+
+  p.upage = pg_round_down (uaddr);
+  e = hash_find (&thread_current ()->pages, &p.elem);
+  return e != NULL ? hash_entry (e, struct page, elem) : NULL;
+}
+
+/* Brings page P into memory and maps it in its owner's page
+   directory,
+   leaving its frame pinned if PIN is true.  Returns true if
+   successful or if P is already resident, false if memory or the
+   backing file gives out. */
+static bool
+page_in (struct page *p, bool pin)
+{
+  uint32_t *pd = p->owner->pagedir;
+  size_t slot = SWAP_SLOT_NONE;
+  bool writable = p->writable;
+  struct frame *f;
+
+  if (frame_pin_page (p))
+    {
+      if (!pin)
+        frame_unpin_page (p);
+      return true;
+    }
+
+  /* Executable pages come from the page cache, where they may
+     already be on behalf of another process or of read(). */
+  if (p->type == PAGE_FILE)
+    {
+      f = frame_cache_map (p, file_get_inode (p->file), p->ofs,
+                           p->read_bytes);
+      if (f != NULL)
+        {
+          writable = false;
+          goto install;
+        }
+    }
+
+  /* P's type and swap slot are only stable once we have a frame:
+     frame_alloc() waits out any eviction of P in progress. */
+  f = frame_alloc (p, p->type == PAGE_ZERO);
+  if (f == NULL)
+    return false;
+  switch (p->type)
+    {
+    case PAGE_ZERO:
+      break;
+
+    case PAGE_FILE:
+    case PAGE_MMAP:
+      if (file_read_at (p->file, f->kpage, p->read_bytes, p->ofs)
+          != (off_t) p->read_bytes)
+        {
+          frame_free_page (p);
+          return false;
+        }
+      memset ((uint8_t *) f->kpage + p->read_bytes, 0,
+              PGSIZE - p->read_bytes);
+      break;
+
+    case PAGE_SWAP:
+      slot = p->swap_slot;
+      swap_read (slot, f->kpage);
+      swap_free (slot);
+      p->swap_slot = SWAP_SLOT_NONE;
+      break;
+
+    default:
+      NOT_REACHED ();
+    }
+
+ install:
+  /* Drop any mapping of the shared zero page. */
+  pagedir_clear_page (pd, p->upage);
+  if (!pagedir_set_page (pd, p->upage, f->kpage, writable))
+    {
+      frame_free_page (p);
+      return false;
+    }
+  if (!pin)
+    frame_unpin_page (p);
+  if (slot != SWAP_SLOT_NONE)
+    page_read_around (p, slot);
+  return true;
+}
+
+/* Brings non-resident PAGE_SWAP page Q in from swap SLOT, if it
+   is still there and a frame is free, and maps it.  Returns true
+   if successful. */
+static bool
+page_read_neighbour (struct page *q, size_t slot)
+{
+  struct frame *f;
+
+  f = frame_try_alloc (q);
+  if (f == NULL)
+    return false;
+  if (q->type != PAGE_SWAP || q->swap_slot != slot)
+    {
+      frame_free_page (q);
+      return false;
+    }
+  swap_read (slot, f->kpage);
+  if (!pagedir_set_page (q->owner->pagedir, q->upage, f->kpage,
+                         q->writable))
+    {
+      frame_free_page (q);
+      return false;
+    }
+  swap_free (slot);
+  q->swap_slot = SWAP_SLOT_NONE;
+  swap_count_read_around ();
+  frame_unpin_page (q);
+  return true;
+}
+
+/* Having just brought page P in from swap SLOT, brings in the
+   pages next to P that sit in the slots next to SLOT, up to
+   SWAP_READ_AROUND on each side.  Eviction sorts pages by address
+   before writing them to adjacent slots, so these were most
+   likely evicted together and will most likely be wanted
+   together.  Only the running thread's own pages are read
+   around, since only it may search its page table. */
+static void
+page_read_around (struct page *p, size_t slot)
+{
+  int dir, d;
+
+  if (p->owner != thread_current ())
+    return;
+  for (dir = -1; dir <= 1; dir += 2)
+    for (d = 1; d <= SWAP_READ_AROUND; d++)
+      {
+        const uint8_t *upage = (uint8_t *) p->upage + dir * d * PGSIZE;
+        size_t want = slot + dir * d;
+        struct page *q;
+
+        if (want == SWAP_SLOT_NONE || !is_user_vaddr (upage))
+          break;
+        q = page_lookup (upage);
+        if (q == NULL || !page_read_neighbour (q, want))
+          break;
+      }
+}
+
+/* Brings the page containing FAULT_ADDR into memory, for writing
+   if WRITE is true.  A PAGE_ZERO page that is only read is
+   mapped to the shared zero page instead.  Returns where the
+   page came from, or FAULT_INVALID if FAULT_ADDR is not part of
+   the address space or memory or the backing file gives out. */
+enum fault_type
+page_load (const void *fault_addr, bool write)
+{
+  struct thread *t = thread_current ();
+  enum fault_type source;
+  struct page *p;
+
+  if (t->pagedir == NULL || !is_user_vaddr (fault_addr))
+    return FAULT_INVALID;
+  p = page_lookup (fault_addr);
+  if (p == NULL)
+    return FAULT_INVALID;
+
+  /* A page that is not resident cannot change type underneath
+     us, so this is where the page will come from. */
+  source = (p->type == PAGE_ZERO ? FAULT_ZERO
+            : p->type == PAGE_SWAP ? FAULT_SWAP
+            : FAULT_FILE);
+  if (!write && p->type == PAGE_ZERO && frame_map_zero (p))
+    {
+      t->zero_page_hits++;
+      return FAULT_ZERO;
+    }
+  return page_in (p, false) ? source : FAULT_INVALID;
+}
+
+/* Returns true if an access to ADDR, with the user stack pointer
+   at ESP, should be taken as the stack growing.  PUSH and PUSHA
+   check permissions before adjusting the stack pointer, so they
+   may fault up to 32 bytes below it. */
+static bool
+is_stack_access (const void *addr, const void *esp)
+{
+  return (is_user_vaddr (addr)
+          && (uintptr_t) addr >= (uintptr_t) PHYS_BASE - stack_limit
+          && (uintptr_t) addr + 32 >= (uintptr_t) esp);
+}
+
+/* Adds a fresh zero page for the stack at ADDR, with the user
+   stack pointer at ESP, if ADDR looks like a stack access and is
+   not already mapped.  Returns the new page or a null pointer. */
+static struct page *
+stack_page_add (const void *addr, const void *esp)
+{
+  if (!is_stack_access (addr, esp)
+      || !page_add_zero (pg_round_down (addr), true))
+    return NULL;
+  return page_lookup (addr);
+}
+
+/* Grows the stack to cover FAULT_ADDR, given the user stack
+   pointer ESP, and brings the new page in.  Returns true if
+   successful, false if FAULT_ADDR does not look like a stack
+   access or memory is short. */
+bool
+page_grow_stack (const void *fault_addr, const void *esp)
+{
+  struct page *p;
+
+  if (thread_current ()->pagedir == NULL)
+    return false;
+  p = stack_page_add (fault_addr, esp);
+  return p != NULL && page_in (p, false);
+}
+
+/* Handles a write to FAULT_ADDR in a page that is present but
+   read-only, by giving the running thread a private copy of a
+   page it shares copy-on-write, or a frame of its own for a
+   PAGE_ZERO page mapped to the shared zero page.  Returns
+   FAULT_COW or FAULT_ZERO accordingly, or FAULT_INVALID if the
+   page really is read-only or memory is short. */
+enum fault_type
+page_unshare (const void *fault_addr)
+{
+  enum fault_type type;
+  struct page *p;
+  bool success;
+
+  if (thread_current ()->pagedir == NULL || !is_user_vaddr (fault_addr))
+    return FAULT_INVALID;
+  p = page_lookup (fault_addr);
+  if (p == NULL || !p->writable)
+    return FAULT_INVALID;
+
+  /* A PAGE_ZERO page without a frame is either mapped to the zero
+     page or gone altogether; either way page_in() zero-fills a
+     frame for it rather than copying anything. */
+  type = p->type == PAGE_ZERO && p->frame == NULL ? FAULT_ZERO : FAULT_COW;
+  if (!page_in (p, true))
+    return FAULT_INVALID;
+  success = frame_unshare (p);
+  frame_unpin_page (p);
+  return success ? type : FAULT_INVALID;
+}
+
+/* Evicts resident page P.  Returns true if P's contents must be
+   written out before its frame can be reused: to its file, if P
+   is a dirty mapped page, or otherwise to swap, if they cannot be
+   recreated from their source, in which case P becomes a
+   PAGE_SWAP page.  The caller does the writing, and assigns the
+   swap slot.  Called by the frame table with the frame lock held;
+   the caller reclaims the frame. */
+bool
+page_out (struct page *p)
+{
+  uint32_t *pd = p->owner->pagedir;
+  enum intr_level old_level;
+  bool dirty;
+
+  /* The owner may be preempted in the middle of writing the page,
+     so read the dirty bit and unmap it in one step. */
+  old_level = intr_disable ();
+  dirty = pagedir_is_dirty (pd, p->upage);
+  pagedir_clear_page (pd, p->upage);
+  intr_set_level (old_level);
+
+  if (p->type == PAGE_MMAP)
+    return dirty;
+  else if (dirty || p->type == PAGE_SWAP)
+    {
+      p->type = PAGE_SWAP;
+      return true;
+    }
+  return false;
+}
+
+/* Brings every page of the SIZE bytes at UADDR into memory and
+   pins it, so that the kernel can access them while holding
+   locks that a page fault would need, growing the stack if the
+   range lies in it.  If WRITE is true, the pages must also be
+   writable.  Returns true if successful,
+   false if any part of the range is not validly mapped; pages
+   pinned before the failure stay pinned, and the caller should
+   page_unpin() the whole range either way. */
+bool
+page_pin (const void *uaddr, size_t size, bool write)
+{
+  const uint8_t *upage;
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+
+  if (size == 0)
+    return true;
+  if (end < (const uint8_t *) uaddr)
+    return false;
+  for (upage = pg_round_down (uaddr); upage < end; upage += PGSIZE)
+    {
+      const void *addr = upage < (const uint8_t *) uaddr ? uaddr : upage;
+      struct page *p = page_lookup (addr);
+      if (p == NULL)
+        p = stack_page_add (addr, thread_current ()->user_esp);
+      if (p == NULL || (write && !p->writable) || !page_in (p, true)
+          || (write && !frame_unshare (p)))
+        return false;
+    }
+  return true;
+}
+
+/* Unpins the pages of the SIZE bytes at UADDR, allowing them to
+   be evicted again.  Pages that are not mapped are ignored. */
+void
+page_unpin (const void *uaddr, size_t size)
+{
+  const uint8_t *upage;
+  const uint8_t *end = (const uint8_t *) uaddr + size;
+
+  if (size == 0 || end < (const uint8_t *) uaddr)
+    return;
+  for (upage = pg_round_down (uaddr); upage < end; upage += PGSIZE)
+    {
+      struct page *p = page_lookup (upage);
+      if (p != NULL)
+        frame_unpin_page (p);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <faultstat.h>
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct frame;
+struct thread;
+
+/* Where the contents of a page come from when it is faulted in. */
+enum page_type
+  {
+    PAGE_FILE,                  /* Read from a file, rest zeroed. */
+    PAGE_ZERO,                  /* All zeros. */
+    PAGE_SWAP,                  /* Anonymous; in swap when evicted. */
+    PAGE_MMAP                   /* Mapped file; written back to it. */
+  };
+
+/* Supplemental page table entry: one virtual page of a user
+   process, whether or not it is currently present in memory. */
+struct page
+  {
+    void *upage;                /* User virtual address. */
+    struct hash_elem elem;      /* Element in thread's `pages'. */
+    enum page_type type;        /* Source of the page's contents. */
+    bool writable;              /* Writable by the user process? */
+    struct thread *owner;       /* Process the page belongs to. */
+    struct frame *frame;        /* Frame holding the page, if resident. */
+    struct list_elem frame_elem; /* Element in frame's `pages'. */
+    bool pinned;                /* Frame exempt from eviction? */
+    size_t swap_slot;           /* PAGE_SWAP: slot when not resident. */
+    bool swapping;              /* On its way to swap or its file? */
+    unsigned last_used;         /* Working-set scan that last saw the
+                                   page accessed. */
+    bool referenced;            /* Accessed bit taken by that scan and
+                                   not yet seen by the clock hand. */
+
+    /* PAGE_FILE and PAGE_MMAP only. */
+    struct file *file;          /* File to read from. */
+    off_t ofs;                  /* Offset in FILE. */
+    size_t read_bytes;          /* Bytes to read; the rest is zeroed. */
+  };
+
+/* Most a user stack may grow to, in bytes. */
+extern size_t stack_limit;
+
+bool page_table_init (void);
+void page_table_destroy (void);
+bool page_table_copy (struct thread *parent);
+
+bool page_add_file (void *upage, struct file *, off_t ofs,
+                    size_t read_bytes, bool writable);
+bool page_add_zero (void *upage, bool writable);
+bool page_add_mmap (void *upage, struct file *, off_t ofs,
+                    size_t read_bytes);
+void page_remove (void *upage);
+struct page *page_lookup (const void *uaddr);
+
+enum fault_type page_load (const void *fault_addr, bool write);
+bool page_grow_stack (const void *fault_addr, const void *esp);
+enum fault_type page_unshare (const void *fault_addr);
+bool page_out (struct page *);
+bool page_pin (const void *uaddr, size_t size, bool write);
+void page_unpin (const void *uaddr, size_t size);
+
+#endif /* vm/page.h */
@@ -0,0 +1,172 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   The swap disk (hdb1, that is, channel 1, device 1) is divided
+   into page-sized slots, each PAGE_SECTORS consecutive sectors,
+   and a bitmap tracks which slots are in use.
+
+   The frame table evicts pages in batches and asks for a run of
+   adjacent slots for each batch, so that a batch goes to disk as
+   one sequential sweep and pages evicted together, which tend to
+   be neighbours in a process's address space, can be read back
+   together.  The pages of a batch are queued on the disk all at
+   once, so the disk driver can merge them into a single
+   command. */
+
+#define PAGE_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+static struct disk *swap_disk;
+static struct bitmap *swap_map;     /* In-use swap slots. */
+static struct lock swap_lock;       /* Protects swap_map and stats. */
+
+/* Statistics. */
+static long long write_cnt;         /* Pages written. */
+static long long read_cnt;          /* Pages read. */
+static long long cluster_cnt;       /* Runs of slots allocated. */
+static long long read_around_cnt;   /* Pages read ahead of a fault. */
+
+/* Finds the swap disk and sets up the slot bitmap.  Without a
+   swap disk, nothing can be swapped out. */
+void
+swap_init (void)
+{
+  size_t slot_cnt = 0;
+
+  swap_disk = disk_get (1, 1);
+  if (swap_disk != NULL)
+    slot_cnt = disk_size (swap_disk) / PAGE_SECTORS;
+  else
+    printf ("swap: no swap disk, swapping disabled\n");
+  swap_map = bitmap_create (slot_cnt);
+  if (swap_map == NULL)
+    PANIC ("swap: bitmap creation failed");
+  lock_init_named (&swap_lock, "swap_lock");
+}
+
+/* Allocates CNT adjacent swap slots and returns the first.  If
+   there is no run that long, returns SWAP_SLOT_NONE; panics if
+   even a single slot cannot be had. */
+size_t
+swap_alloc (size_t cnt)
+{
+  size_t slot;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (swap_map, 0, cnt, false);
+  if (slot != BITMAP_ERROR)
+    cluster_cnt++;
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    {
+      if (cnt == 1)
+        PANIC ("swap: out of swap space");
+      return SWAP_SLOT_NONE;
+    }
+  return slot;
+}
+
+/* Writes the page at KPAGE to swap SLOT. */
+void
+swap_write (size_t slot, const void *kpage)
+{
+  enum disk_tag old_tag;
+
+  ASSERT (slot != SWAP_SLOT_NONE);
+
+  old_tag = disk_set_tag (DISK_TAG_SWAP);
+  disk_write_multiple (swap_disk, slot * PAGE_SECTORS, PAGE_SECTORS, kpage);
+  disk_set_tag (old_tag);
+  lock_acquire (&swap_lock);
+  write_cnt++;
+  lock_release (&swap_lock);
+}
+
+/* Writes the CNT pages at KPAGES[] to the CNT swap slots starting
+   at SLOT, queueing them all before waiting for any. */
+void
+swap_write_pages (size_t slot, void *const kpages[], size_t cnt)
+{
+  struct disk_request *reqs;
+  enum disk_tag old_tag;
+  size_t i;
+
+  ASSERT (slot != SWAP_SLOT_NONE);
+
+  reqs = malloc (cnt * sizeof *reqs);
+  if (reqs == NULL)
+    {
+      for (i = 0; i < cnt; i++)
+        swap_write (slot + i, kpages[i]);
+      return;
+    }
+
+  old_tag = disk_set_tag (DISK_TAG_SWAP);
+  for (i = 0; i < cnt; i++)
+    {
+      disk_request_init (&reqs[i], swap_disk, (slot + i) * PAGE_SECTORS,
+                         PAGE_SECTORS, kpages[i], true);
+      disk_submit (&reqs[i]);
+    }
+  disk_set_tag (old_tag);
+  for (i = 0; i < cnt; i++)
+    disk_wait (&reqs[i]);
+  free (reqs);
+
+  lock_acquire (&swap_lock);
+  write_cnt += cnt;
+  lock_release (&swap_lock);
+}
+
+/* Reads swap SLOT into KPAGE.  The slot stays allocated. */
+void
+swap_read (size_t slot, void *kpage)
+{
+  enum disk_tag old_tag;
+
+  ASSERT (slot != SWAP_SLOT_NONE);
+
+  old_tag = disk_set_tag (DISK_TAG_SWAP);
+  disk_read_multiple (swap_disk, slot * PAGE_SECTORS, PAGE_SECTORS, kpage);
+  disk_set_tag (old_tag);
+  lock_acquire (&swap_lock);
+  read_cnt++;
+  lock_release (&swap_lock);
+}
+
+/* Releases swap SLOT. */
+void
+swap_free (size_t slot)
+{
+  ASSERT (slot != SWAP_SLOT_NONE);
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_map, slot));
+  bitmap_reset (swap_map, slot);
+  lock_release (&swap_lock);
+}
+
+/* Records that a page was read ahead of a fault. */
+void
+swap_count_read_around (void)
+{
+  lock_acquire (&swap_lock);
+  read_around_cnt++;
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  printf ("Swap: %lld pages written in %lld clusters, "
+          "%lld pages read (%lld by read-around)\n",
+          write_cnt, cluster_cnt, read_cnt, read_around_cnt);
+}
@@ -0,0 +1,18 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stddef.h>
+
+/* No swap slot. */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
+void swap_init (void);
+size_t swap_alloc (size_t cnt);
+void swap_write (size_t slot, const void *kpage);
+void swap_write_pages (size_t slot, void *const kpages[], size_t cnt);
+void swap_read (size_t slot, void *kpage);
+void swap_free (size_t slot);
+void swap_count_read_around (void);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */
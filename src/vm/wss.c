@@ -0,0 +1,197 @@
+#include "vm/wss.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+
+/* Working-set scanner.
+
+   A kernel thread wakes every WSS_PERIOD ticks and samples the
+   accessed bit of every resident user page, clearing it and
+   recording the scan in the page's `last_used'.  A process's
+   working set is estimated as its pages used within the last
+   WSS_WINDOW scans.
+
+   The estimates steer eviction, which passes over pages in their
+   owner's working set on its first lap (see frame_evict()), and
+   the start of new processes: process_execute() calls
+   wss_admit(), which holds off a new process while the working
+   sets of those already running leave it no room in the user
+   pool, so that starting it would only make everyone thrash.  A
+   process waiting on exec is not touching its pages, so its own
+   working set shrinks as it waits; even so, a start is held off
+   for at most WSS_ADMIT_TRIES scans. */
+
+#define WSS_PERIOD (TIMER_FREQ / 4)     /* Ticks between scans. */
+#define WSS_WINDOW 4                    /* Scans a page stays active. */
+#define WSS_EXEC_PAGES 16               /* Room a new process needs. */
+#define WSS_ADMIT_TRIES 8               /* Most scans to hold off exec. */
+
+static unsigned scan_cnt;               /* Scans started. */
+static unsigned total_wss;              /* Sum of all working sets. */
+static long long admit_delay_cnt;       /* Process starts held off. */
+static long long admit_force_cnt;       /* ...and then let through
+                                           without room. */
+
+static thread_func scanner;
+
+/* Starts the working-set scanner. */
+void
+wss_init (void)
+{
+  thread_create ("wss", PRI_DEFAULT, scanner, NULL);
+}
+
+/* Returns true if P has been used within the last WSS_WINDOW
+   scans, that is, if it is in its owner's working set. */
+bool
+wss_page_active (const struct page *p)
+{
+  return scan_cnt - p->last_used < WSS_WINDOW;
+}
+
+/* Samples and clears the accessed bit of resident page P and
+   counts it towards its owner's sizes. */
+static void
+sample_page (struct page *p, void *aux UNUSED)
+{
+  struct thread *t = p->owner;
+  enum intr_level old_level;
+
+  /* The owner may be preempted in the middle of writing the page;
+     don't let clearing the accessed bit lose the dirty bit. */
+  old_level = intr_disable ();
+  if (pagedir_is_accessed (t->pagedir, p->upage))
+    {
+      pagedir_set_accessed (t->pagedir, p->upage, false);
+      p->referenced = true;
+      p->last_used = scan_cnt;
+    }
+  intr_set_level (old_level);
+
+  t->rss_count++;
+  if (wss_page_active (p))
+    t->wss_count++;
+}
+
+static void
+reset_counts (struct thread *t, void *aux UNUSED)
+{
+  t->wss_count = t->rss_count = 0;
+}
+
+static void
+publish_counts (struct thread *t, void *total_)
+{
+  unsigned *total = total_;
+
+  t->wss = t->wss_count;
+  t->rss = t->rss_count;
+  *total += t->wss;
+}
+
+/* Scanner thread. */
+static void
+scanner (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+      unsigned total = 0;
+
+      timer_sleep (WSS_PERIOD);
+
+      old_level = intr_disable ();
+      thread_foreach (reset_counts, NULL);
+      intr_set_level (old_level);
+
+      scan_cnt++;
+      frame_for_each_page (sample_page, NULL);
+
+      old_level = intr_disable ();
+      thread_foreach (publish_counts, &total);
+      total_wss = total;
+      intr_set_level (old_level);
+    }
+}
+
+/* Waits until the working sets of the running processes leave
+   room in the user pool for one more, or for WSS_ADMIT_TRIES
+   scans, whichever comes first. */
+void
+wss_admit (void)
+{
+  int tries;
+
+  for (tries = 0; ; tries++)
+    {
+      size_t used, total;
+
+      palloc_get_stats (PAL_USER, &used, &total);
+      if (total_wss + WSS_EXEC_PAGES <= total)
+        return;
+      if (tries == WSS_ADMIT_TRIES)
+        {
+          admit_force_cnt++;
+          return;
+        }
+      if (tries == 0)
+        admit_delay_cnt++;
+      timer_sleep (WSS_PERIOD);
+    }
+}
+
+/* Snapshot state for wss_get_stats(). */
+struct stats_aux
+  {
+    struct wssstat *stats;
+    int max;
+    int cnt;
+  };
+
+static void
+get_stats (struct thread *t, void *aux_)
+{
+  struct stats_aux *aux = aux_;
+  struct wssstat *ws;
+
+  if (t->pagedir == NULL || aux->cnt >= aux->max)
+    return;
+  ws = &aux->stats[aux->cnt++];
+  ws->tid = t->tid;
+  strlcpy (ws->name, t->name, sizeof ws->name);
+  ws->wss = t->wss;
+  ws->rss = t->rss;
+}
+
+/* Copies the estimates for up to MAX user processes into STATS
+   and returns the number of entries filled in. */
+int
+wss_get_stats (struct wssstat *stats, int max)
+{
+  struct stats_aux aux;
+  enum intr_level old_level;
+
+  aux.stats = stats;
+  aux.max = max;
+  aux.cnt = 0;
+  old_level = intr_disable ();
+  thread_foreach (get_stats, &aux);
+  intr_set_level (old_level);
+  return aux.cnt;
+}
+
+/* Prints working-set statistics. */
+void
+wss_print_stats (void)
+{
+  printf ("Working set: %u scans, %u pages in use, "
+          "%lld process starts delayed (%lld without room)\n",
+          scan_cnt, total_wss, admit_delay_cnt, admit_force_cnt);
+}
@@ -0,0 +1,15 @@
+#ifndef VM_WSS_H
+#define VM_WSS_H
+
+#include <stdbool.h>
+#include <wssstat.h>
+
+struct page;
+
+void wss_init (void);
+bool wss_page_active (const struct page *);
+void wss_admit (void);
+int wss_get_stats (struct wssstat *, int max);
+void wss_print_stats (void);
+
+#endif /* vm/wss.h */